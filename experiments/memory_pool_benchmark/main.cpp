@@ -5,22 +5,39 @@
 #include "main.h"
 #include <iostream>
 #include "memory_pool.h"
+#include "memory_arena.h"
 #include "spdlog/spdlog.h"
 
 #ifdef USELIB_MIMALLOC
 #include "mimalloc.h"
 #endif
 
+#ifdef __linux__
+#include <fstream>
+#include <unistd.h>
+#endif
+
 
 void BenchmarkRun(int runNumber);
 void MultithreadedBenchmarkRun(int runNumber);
+void ArenaBenchmarkRun(int runNumber);
 void SimpleTemplateTest();
 
+//the global new build replaces operator new/delete with the multithreaded pool, so the std rows measure it
+#ifdef USE_GLOBAL_NEW_REPLACEMENT
+const char* const StdTimeLabel = "    std (pool new) time";
+#else
+const char* const StdTimeLabel = "              std time";
+#endif
+
 enum class AllocType
 {
 	Std,
 	PoolSingleThreaded,
 	PoolMultiThreaded,
+	PoolSingleThreadedBatch,
+	PoolMultiThreadedBatch,
+	Arena,
 	MS_mimalloc
 };
 
@@ -41,6 +58,13 @@ int main()
 		BenchmarkRun(i);
 	}
 
+	spdlog::info("---------- Arena benchmark ----------");
+
+	for (int i = 0; i < BenchmarkRuns; i++)
+	{
+		ArenaBenchmarkRun(i);
+	}
+
 	spdlog::info("---------- Multithreaded benchmark ----------");
 
 	for (int i = 0; i < BenchmarkRuns; i++)
@@ -96,7 +120,7 @@ template<typename T, AllocType allocType> T* Allocate()
 #endif
 
 	{
-		spdlog::error("Invalid allocation type: {}", allocType);
+		spdlog::error("Invalid allocation type: {}", static_cast<int>(allocType));
 		return new T();
 	}
 }
@@ -131,7 +155,7 @@ template<typename T, AllocType allocType> void Deallocate(T* p)
 #endif
 
 	{
-		spdlog::error("Invalid allocation type: {}", allocType);
+		spdlog::error("Invalid allocation type: {}", static_cast<int>(allocType));
 		delete p;
 	}
 }
@@ -139,6 +163,24 @@ template<typename T, AllocType allocType> void Deallocate(T* p)
 
 template<AllocType allocType, typename T> void AllocateSomeObjects(std::vector<T*>& container, int amountToAllocate)
 {
+	//batch types append the whole amount with a single pool request
+	if constexpr(allocType == AllocType::PoolSingleThreadedBatch || allocType == AllocType::PoolMultiThreadedBatch)
+	{
+		auto size = container.size();
+		container.resize(size + amountToAllocate);
+
+		if constexpr(allocType == AllocType::PoolSingleThreadedBatch)
+		{
+			st::memory::MemoryPoolSingleThreaded::AllocateBatch(amountToAllocate, container.data() + size);
+		}
+		else
+		{
+			st::memory::MemoryPoolMultiThreaded::AllocateBatch(amountToAllocate, container.data() + size);
+		}
+
+		return;
+	}
+
 	for (int i = 0; i < amountToAllocate; i++)
 	{
 		auto p = Allocate<T, allocType>();
@@ -148,6 +190,21 @@ template<AllocType allocType, typename T> void AllocateSomeObjects(std::vector<T
 
 template<AllocType allocType, typename T> void DeallocateAllObjects(std::vector<T*>& container)
 {
+	if constexpr(allocType == AllocType::PoolSingleThreadedBatch || allocType == AllocType::PoolMultiThreadedBatch)
+	{
+		if constexpr(allocType == AllocType::PoolSingleThreadedBatch)
+		{
+			st::memory::MemoryPoolSingleThreaded::DeallocateBatch(container.data(), (int)container.size());
+		}
+		else
+		{
+			st::memory::MemoryPoolMultiThreaded::DeallocateBatch(container.data(), (int)container.size());
+		}
+
+		container.clear();
+		return;
+	}
+
 	auto size = container.size();
 
 	for (int i = 0; i < size; i++)
@@ -244,6 +301,25 @@ auto GetDurationInMicroseconds(TimePoint from, TimePoint to)
 }
 
 
+//resident set size in kilobytes, -1 if it's not available
+int64_t GetResidentMemoryKb()
+{
+#ifdef __linux__
+	std::ifstream statm("/proc/self/statm");
+
+	int64_t totalPages = 0;
+	int64_t residentPages = 0;
+
+	if (statm >> totalPages >> residentPages)
+	{
+		return residentPages * sysconf(_SC_PAGESIZE) / 1024;
+	}
+#endif
+
+	return -1;
+}
+
+
 void BenchmarkRun(int runNumber)
 {
 	spdlog::info("ST BENCHMARK RUN {}", runNumber + 1);
@@ -255,7 +331,7 @@ void BenchmarkRun(int runNumber)
 		auto timeStart = std::chrono::high_resolution_clock::now();
 		Benchmark<AllocType::Std>(BenchmarkIterationsCount);
 		auto timeEnd = std::chrono::high_resolution_clock::now();
-		spdlog::info("              std time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
+		spdlog::info("{}: {}", StdTimeLabel, GetDurationInMicroseconds(timeStart, timeEnd));
 	}
 
 	//memory pool single threaded
@@ -274,6 +350,22 @@ void BenchmarkRun(int runNumber)
 		spdlog::info("   memory pool MT time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
 	}
 
+	//memory pool single threaded, batch requests
+	{
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		Benchmark<AllocType::PoolSingleThreadedBatch>(BenchmarkIterationsCount);
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		spdlog::info("   memory pool ST batch time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
+	}
+
+	//memory pool multithreaded, batch requests
+	{
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		Benchmark<AllocType::PoolMultiThreadedBatch>(BenchmarkIterationsCount);
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		spdlog::info("   memory pool MT batch time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
+	}
+
 #ifdef USELIB_MIMALLOC
 	//mimalloc
 	{
@@ -284,92 +376,215 @@ void BenchmarkRun(int runNumber)
 	}
 #endif
 
+	//all items are freed by now, the extra pages the pools grew stay until trimmed
+	{
+		auto rssBefore = GetResidentMemoryKb();
+		auto trimmedBytes = st::memory::MemoryPoolSingleThreaded::Trim() + st::memory::MemoryPoolMultiThreaded::Trim();
+		auto rssAfter = GetResidentMemoryKb();
+
+		spdlog::info("   memory pools trim: {} KB, RSS: {} KB -> {} KB", trimmedBytes / 1024, rssBefore, rssAfter);
+	}
+
 	spdlog::info(" ");
 
 }
 
 
-void MultithreadedBenchmarkRun(int runNumber)
+template<AllocType allocType> auto MultithreadedBenchmark(int threadsCount, int iterations)
 {
-	spdlog::info("MT BENCHMARK RUN {}", runNumber + 1);
+	std::vector<std::thread> threads;
+	threads.reserve(threadsCount);
 
-	const int BenchmarkIterationsCount = 25000;
+	auto timeStart = std::chrono::high_resolution_clock::now();
 
-	int threadsCount = 4; // std::max<int>(2, std::thread::hardware_concurrency() - 2);
+	for (int i = 0; i < threadsCount; i++)
+	{
+		threads.emplace_back(Benchmark<allocType>, iterations);
+	}
 
-	std::vector<std::thread> threads;
-	threads.reserve(threadsCount);
+	for (int i = 0; i < threadsCount; i++)
+	{
+		threads[i].join();
+	}
 
-	//std
+	auto timeEnd = std::chrono::high_resolution_clock::now();
+
+	return GetDurationInMicroseconds(timeStart, timeEnd);
+}
+
+
+//per frame data: every frame allocates its items, all of them are freed at the end of the frame
+//the pool frees them one by one, the arena drops them with a single reset
+template<AllocType allocType> void FrameBenchmark(int framesCount, int frameItemsCount, st::memory::MemoryArena* pArena = nullptr)
+{
+	const size_t ItemSizes[] = {8, 64, 1024+512+256};
+
+	std::vector<void*> pointers(frameItemsCount);
+
+	auto getItemSize = [&ItemSizes](int itemIndex)
 	{
-		auto timeStart = std::chrono::high_resolution_clock::now();
+		return ItemSizes[itemIndex % 10 == 0 ? 2 : (itemIndex % 4 == 0 ? 1 : 0)];
+	};
 
-		for (int i = 0; i < threadsCount; i++)
+	for (int frame = 0; frame < framesCount; frame++)
+	{
+		for (int i = 0; i < frameItemsCount; i++)
 		{
-			threads.emplace_back(Benchmark<AllocType::Std>, BenchmarkIterationsCount);
+			size_t size = getItemSize(i);
+			void* p;
+
+			if constexpr(allocType == AllocType::Std)
+			{
+				p = new char[size];
+			}
+			else if constexpr(allocType == AllocType::PoolSingleThreaded)
+			{
+				p = st::memory::MemoryPoolSingleThreaded::Allocate(size);
+			}
+			else
+			{
+				static_assert(allocType == AllocType::Arena);
+				p = pArena->Allocate(size);
+			}
+
+			*static_cast<char*>(p) = (char)i;
+			pointers[i] = p;
 		}
 
-		for (int i = 0; i < threadsCount; i++)
+		if constexpr(allocType == AllocType::Arena)
 		{
-			threads[i].join();
+			pArena->Reset();
+			continue;
 		}
 
-		auto timeEnd = std::chrono::high_resolution_clock::now();
-		spdlog::info("              std time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
+		for (int i = 0; i < frameItemsCount; i++)
+		{
+			if constexpr(allocType == AllocType::Std)
+			{
+				delete[] static_cast<char*>(pointers[i]);
+			}
+			else
+			{
+				st::memory::MemoryPoolSingleThreaded::Deallocate(pointers[i], getItemSize(i));
+			}
+		}
 	}
+}
 
-	threads.clear();
 
-	//memory pool multithreaded
+void ArenaBenchmarkRun(int runNumber)
+{
+	spdlog::info("ARENA BENCHMARK RUN {}", runNumber + 1);
+
+	const int FramesCount = 200;
+	const int FrameItemsCount = 10000;
+
+	//std
 	{
 		auto timeStart = std::chrono::high_resolution_clock::now();
+		FrameBenchmark<AllocType::Std>(FramesCount, FrameItemsCount);
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		spdlog::info("{}: {}", StdTimeLabel, GetDurationInMicroseconds(timeStart, timeEnd));
+	}
 
-		for (int i = 0; i < threadsCount; i++)
-		{
-			threads.emplace_back(Benchmark<AllocType::PoolMultiThreaded>, BenchmarkIterationsCount);
-		}
+	//memory pool single threaded
+	{
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		FrameBenchmark<AllocType::PoolSingleThreaded>(FramesCount, FrameItemsCount);
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		spdlog::info("   memory pool ST time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
+	}
 
-		for (int i = 0; i < threadsCount; i++)
-		{
-			threads[i].join();
-		}
+	//arena, mmap chunks
+	{
+		st::memory::MemoryArena arena(st::memory::MemoryArena::DefaultChunkSize, st::memory::MemoryArenaChunkSource::Mmap);
 
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		FrameBenchmark<AllocType::Arena>(FramesCount, FrameItemsCount, &arena);
 		auto timeEnd = std::chrono::high_resolution_clock::now();
-		spdlog::info("   memory pool MT time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
+		spdlog::info("   arena (mmap chunks) time: {}, reserved: {} KB", GetDurationInMicroseconds(timeStart, timeEnd), arena.GetReservedSize() / 1024);
 	}
 
-	threads.clear();
-
-#ifdef USELIB_MIMALLOC
-	//mimalloc
+	//arena, chunks of the largest bucket size come from the multithreaded pool buckets
 	{
+		st::memory::MemoryArena arena(16 * 1024, st::memory::MemoryArenaChunkSource::Pool);
+
 		auto timeStart = std::chrono::high_resolution_clock::now();
+		FrameBenchmark<AllocType::Arena>(FramesCount, FrameItemsCount, &arena);
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		spdlog::info("   arena (pool chunks) time: {}, reserved: {} KB", GetDurationInMicroseconds(timeStart, timeEnd), arena.GetReservedSize() / 1024);
+	}
 
-		for (int i = 0; i < threadsCount; i++)
-		{
-			threads.emplace_back(Benchmark<AllocType::MS_mimalloc>, BenchmarkIterationsCount);
-		}
+	spdlog::info(" ");
+}
 
-		for (int i = 0; i < threadsCount; i++)
-		{
-			threads[i].join();
-		}
 
-		auto timeEnd = std::chrono::high_resolution_clock::now();
-		spdlog::info("      MS mimalloc time: {}", GetDurationInMicroseconds(timeStart, timeEnd));
-	}
+//the multithreaded pool is re-initialized with each of these
+struct MultithreadedPoolConfig
+{
+	const char* m_pName;
+	st::memory::MemoryPoolSyncMode m_SyncMode;
+	bool m_ThreadCaches;
+	bool m_BackgroundProvisioning;
+};
 
-	threads.clear();
+const MultithreadedPoolConfig MultithreadedPoolConfigs[] =
+{
+	{"   memory pool MT (mutex) time", st::memory::MemoryPoolSyncMode::Mutex, false, false},
+	{"   memory pool MT (mutex + background provisioning) time", st::memory::MemoryPoolSyncMode::Mutex, false, true},
+	{"   memory pool MT (mutex + thread caches) time", st::memory::MemoryPoolSyncMode::Mutex, true, false},
+	{"   memory pool MT (lock-free) time", st::memory::MemoryPoolSyncMode::LockFree, false, false},
+	{"   memory pool MT (lock-free + thread caches) time", st::memory::MemoryPoolSyncMode::LockFree, true, false},
+	{"   memory pool MT (thread owned heaps) time", st::memory::MemoryPoolSyncMode::ThreadOwned, false, false},
+	{"   memory pool MT (per cpu shards) time", st::memory::MemoryPoolSyncMode::PerCpu, false, false}
+};
 
-#endif
+void ReinitMultithreadedPool(const MultithreadedPoolConfig& config)
+{
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+
+	settings.SetSyncMode(config.m_SyncMode);
+	settings.SetBackgroundProvisioning(config.m_BackgroundProvisioning);
+
+	if (config.m_ThreadCaches == false)
+	{
+		settings.SetThreadCacheSize(0, 0);
+	}
 
+	st::memory::MemoryPoolMultiThreaded::Release();
+	st::memory::MemoryPoolMultiThreaded::Init(settings);
 }
 
 
+void MultithreadedBenchmarkRun(int runNumber)
+{
+	spdlog::info("MT BENCHMARK RUN {}", runNumber + 1);
 
+	//every thread does the same amount of work, so the ideal scaling keeps the time flat
+	const int BenchmarkIterationsCount = 25000;
 
+	//more threads than cores: per cpu shards keep their count, thread heaps and caches grow with the threads
+	const int ThreadsCounts[] = {1, 2, 4, 8, 16, 32, 64};
 
+	for (int threadsCount : ThreadsCounts)
+	{
+		spdlog::info(" threads: {}", threadsCount);
 
+		//std
+		spdlog::info("{}: {}", StdTimeLabel, MultithreadedBenchmark<AllocType::Std>(threadsCount, BenchmarkIterationsCount));
 
+		//memory pool multithreaded
+		for (auto& config : MultithreadedPoolConfigs)
+		{
+			ReinitMultithreadedPool(config);
+			spdlog::info("{}: {}", config.m_pName, MultithreadedBenchmark<AllocType::PoolMultiThreaded>(threadsCount, BenchmarkIterationsCount));
+		}
 
+#ifdef USELIB_MIMALLOC
+		//mimalloc
+		spdlog::info("      MS mimalloc time: {}", MultithreadedBenchmark<AllocType::MS_mimalloc>(threadsCount, BenchmarkIterationsCount));
+#endif
+	}
 
+	spdlog::info(" ");
+}
@@ -4,10 +4,19 @@
 
 
 #include <cstdlib>
+#include <algorithm>
+#include <limits>
 #include "memory_pool_bucket.h"
+#include "memory_pool_page_map.h"
+#include "memory_pool_internal_scope.h"
 #include <cassert>
 #include "spdlog/spdlog.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace st::memory
 {
 
@@ -15,175 +24,639 @@ namespace st::memory
 			m_ItemSize(0),
 			m_FirstPageItemsCount(0),
 			m_ExtraPageItemsCount(0),
-			m_Pages(),
-			m_Items()
+			m_MaxExtraPageItemsCount(0),
+			m_ProvisioningWatermark(0),
+			m_PageBacking(MemoryPoolPageBacking::Heap),
+			m_IsLockFree(false),
+			m_RetainedEmptyPagesCount(MemoryPoolSettings::RetainAllEmptyPages),
+			m_PagesCount(0),
+			m_EmptyExtraPagesCount(0),
+			m_TotalItemsCount(0),
+			m_FreeItemsCount(0),
+			m_pPages(nullptr),
+			m_pAvailableSlabs(nullptr),
+			m_LockFreeItems(),
+			m_RemoteFreeItems(),
+			m_pOwner(nullptr)
 	{
 
 	}
 
 	MemoryPoolBucket::~MemoryPoolBucket()
 	{
+		ReclaimRemoteItems();
+
 		if (GetFreeItemsCount() != GetTotalItemsCount())
 		{
 			int unreleasedCount = GetTotalItemsCount() - GetFreeItemsCount();
 			spdlog::error("Memory Pool: unreleased pointers ({} in total) for bucket with item size {}", unreleasedCount, m_ItemSize);
+
+			//the pages are kept for the unreleased items, later pools must not take them for their own
+			for (auto pPage = m_pPages.load(); pPage != nullptr; pPage = pPage->m_pNextPage)
+			{
+				MemoryPoolPageMap::Orphan(pPage, pPage->m_PageSlabsCount);
+			}
+
 			return;
 		}
 
-		for (auto pPage : m_Pages)
+		auto pPage = m_pPages.load();
+
+		while (pPage != nullptr)
 		{
-			std::free(pPage);
+			auto pNextPage = pPage->m_pNextPage;
+			MemoryPoolPageMap::Unregister(pPage, pPage->m_PageSlabsCount);
+			FreePageMemory(pPage, pPage->m_PageSlabsCount * MemoryPoolSlab::SlabSize);
+			pPage = pNextPage;
 		}
 	}
 
 
-	void MemoryPoolBucket::Setup(const MemoryPoolSettings::BucketDefinition &bucketDefinition)
+	void MemoryPoolBucket::Setup(const MemoryPoolSettings::BucketDefinition &bucketDefinition, bool isLockFree, int retainedEmptyPagesCount, size_t maxExtraPageSize)
 	{
-		m_ItemSize = bucketDefinition.m_ItemSize;
+		m_IsLockFree = isLockFree;
+		m_RetainedEmptyPagesCount = retainedEmptyPagesCount;
+
+		//free items hold the free list link, so an item can't be smaller than a pointer
+		m_ItemSize = std::max(bucketDefinition.m_ItemSize, (int)sizeof(void*));
 		m_FirstPageItemsCount = bucketDefinition.m_FirstPageItemsCount;
 		m_ExtraPageItemsCount = bucketDefinition.m_ExtraPageItemsCount;
+		m_PageBacking = bucketDefinition.m_PageBacking;
 
 		assert(m_ItemSize > 0);
 		assert(m_FirstPageItemsCount > 0);
 		assert(m_ExtraPageItemsCount > 0);
 
-		assert(m_Pages.size() == 0);
-		assert(m_Items.size() == 0);
+		assert(m_pPages.load() == nullptr);
+
+		//growth never goes below the bucket definition
+		m_MaxExtraPageItemsCount = (int)std::min(maxExtraPageSize / m_ItemSize, (size_t)std::numeric_limits<int>::max() / 2);
+		m_MaxExtraPageItemsCount = std::max(m_MaxExtraPageItemsCount, m_ExtraPageItemsCount);
+
+		UpdateProvisioningWatermark();
 
 		//validating item size
 		if (m_ItemSize < sizeof(std::max_align_t))
 		{
-			if (m_ItemSize != 2 && m_ItemSize != 4 && m_ItemSize != 8)
+			if (m_ItemSize != 8)
 			{
 				spdlog::warn("Memory pool: inefficient bucket item size: {}", m_ItemSize);
 			}
 		}
 
-		m_Pages.reserve(32);
-		m_Items.reserve(m_FirstPageItemsCount + m_ExtraPageItemsCount);
+		if (MemoryPoolSlab::GetItemsCapacity(m_ItemSize) == 0)
+		{
+			spdlog::error("Memory pool: bucket item size {} doesn't fit into a slab ({} bytes)", m_ItemSize, MemoryPoolSlab::SlabSize);
+			assert(false);
+		}
 
 		if (bucketDefinition.m_PreWarmFirstPage)
 		{
-			AddPage();
+			if (m_IsLockFree)
+			{
+				m_LockFreeItems.Push(AddPageLockFree());
+			}
+			else
+			{
+				AddPage();
+			}
 		}
 	}
 
 
-	void* MemoryPoolBucket::Allocate()
+	void MemoryPoolBucket::AllocateBatch(void** pOut, int count)
 	{
-		if (m_Items.empty())
+		int allocatedCount = 0;
+
+		while (allocatedCount < count)
 		{
-			AddPage();
-		}
+			if (m_pAvailableSlabs == nullptr)
+			{
+				AddPage();
+			}
 
-		assert(m_Items.empty() == false);
+			auto pSlab = m_pAvailableSlabs;
 
-		auto pResult = m_Items.back();
-		m_Items.pop_back();
+			if (pSlab->IsEmpty())
+			{
+				OnSlabUsed(pSlab);
+			}
 
-		return pResult;
+			int takenCount = pSlab->AllocateBatch(pOut + allocatedCount, count - allocatedCount);
+			m_FreeItemsCount -= takenCount;
+			allocatedCount += takenCount;
+
+			if (pSlab->IsFull())
+			{
+				RemoveAvailableSlab(pSlab);
+			}
+		}
 	}
 
 
-	void MemoryPoolBucket::Deallocate(void* p)
+	void MemoryPoolBucket::DeallocateBatch(void** pItems, int count)
 	{
-		//check that the address is within pages
-#ifdef MEMORY_POOL_CHECK_ADDRESS_BOUNDS
-		assert(CheckIfAddressIsWithinPages(p) == true);
-#endif
+		int i = 0;
+
+		while (i < count)
+		{
+			auto pSlab = MemoryPoolSlab::FromPointer(pItems[i]);
 
-		//check that the address is not already in m_Items
+			assert(pSlab->m_pBucket == this);
+
+			bool wasFull = pSlab->IsFull();
+			int runStart = i;
+
+			do
+			{
 #ifdef MEMORY_POOL_CHECK_ADDRESS_BOUNDS
-		auto searchResult = std::find(std::begin(m_Items), std::end(m_Items), p);
-		assert(searchResult == std::end(m_Items));
+				CheckDeallocation(pItems[i]);
 #endif
+				pSlab->Deallocate(pItems[i]);
+				i++;
+			}
+			while (i < count && MemoryPoolSlab::FromPointer(pItems[i]) == pSlab);
 
-		m_Items.push_back(p);
+			m_FreeItemsCount += i - runStart;
+
+			if (wasFull)
+			{
+				AddAvailableSlab(pSlab);
+			}
+
+			//the slab (and its page) may be freed here, none of the remaining items belongs to it
+			if (pSlab->IsEmpty())
+			{
+				OnSlabEmptied(pSlab);
+			}
+		}
 
 		assert(GetFreeItemsCount() <= GetTotalItemsCount());
 	}
 
 
+	void MemoryPoolBucket::AllocateBatchLockFree(void** pOut, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			pOut[i] = AllocateLockFree();
+		}
+	}
+
+
+	void MemoryPoolBucket::DeallocateBatchLockFree(void** pItems, int count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		for (int i = 0; i < count - 1; i++)
+		{
+#ifdef MEMORY_POOL_CHECK_ADDRESS_BOUNDS
+			assert(CheckIfAddressIsWithinPages(pItems[i]) == true);
+#endif
+			*static_cast<void**>(pItems[i]) = pItems[i + 1];
+		}
+
+		DeallocateChainLockFree(pItems[0], pItems[count - 1]);
+	}
+
+
 	void MemoryPoolBucket::AddPage()
 	{
-		int itemsCount;
-		bool pageIsExtra;
+		int slabsCount;
+		auto pPage = CreatePage(slabsCount);
+
+		MakePageAvailable(pPage, slabsCount);
+	}
+
+
+	void MemoryPoolBucket::AddPreparedPage(MemoryPoolSlab* pPage, int slabsCount)
+	{
+		assert(m_IsLockFree == false);
 
-		if (m_Pages.empty())
+		pPage->m_IsExtraPage = m_pPages.load(std::memory_order_relaxed) != nullptr;
+
+		LinkPage(pPage, slabsCount);
+		MakePageAvailable(pPage, slabsCount);
+	}
+
+
+	void MemoryPoolBucket::MakePageAvailable(MemoryPoolSlab* pPage, int slabsCount)
+	{
+		//slabs are made available in address order, items themselves are carved lazily
+		for (int i = slabsCount - 1; i >= 0; i--)
 		{
-			itemsCount = m_FirstPageItemsCount;
-			pageIsExtra = false;
+			auto pSlab = reinterpret_cast<MemoryPoolSlab*>(reinterpret_cast<char*>(pPage) + i * MemoryPoolSlab::SlabSize);
+			AddAvailableSlab(pSlab);
 		}
-		else
+
+		m_FreeItemsCount += slabsCount * MemoryPoolSlab::GetItemsCapacity(m_ItemSize);
+
+		//all slabs of a new page are empty
+		pPage->m_PageEmptySlabsCount = slabsCount;
+
+		if (pPage->m_IsExtraPage)
 		{
-			itemsCount = m_ExtraPageItemsCount;
-			pageIsExtra = true;
+			m_EmptyExtraPagesCount++;
 		}
+	}
+
 
-		int pageSize = itemsCount * m_ItemSize;
+	//the whole page is carved into one chain: the first item goes to the caller, the rest is pushed at once
+	void* MemoryPoolBucket::AddPageLockFree()
+	{
+		int slabsCount;
+		auto pPage = CreatePage(slabsCount);
 
-		void* pNewPage = std::malloc(pageSize);
+		void* pFirst = nullptr;
+		void* pLast = nullptr;
 
-		//adding new items
-		for (int i = 0; i < itemsCount; i++)
+		for (int i = 0; i < slabsCount; i++)
 		{
-			auto pItem = static_cast<char*>(pNewPage) + i * m_ItemSize;
-			m_Items.push_back(pItem);
+			auto pSlab = reinterpret_cast<MemoryPoolSlab*>(reinterpret_cast<char*>(pPage) + i * MemoryPoolSlab::SlabSize);
+
+			while (pSlab->IsFull() == false)
+			{
+				void* pItem = pSlab->Allocate();
+
+				if (pLast != nullptr)
+				{
+					*static_cast<void**>(pLast) = pItem;
+				}
+				else
+				{
+					pFirst = pItem;
+				}
+
+				pLast = pItem;
+			}
 		}
 
-		//adding page to pages
-		m_Pages.push_back(pNewPage);
+		assert(pFirst != nullptr);
+
+		void* pResult = pFirst;
+		pFirst = *static_cast<void**>(pFirst);
 
-		if (pageIsExtra)
+		if (pFirst != nullptr)
 		{
-			spdlog::info("Memory pool: adding extra page for item size [{}], new pages count: [{}].", m_ItemSize, m_Pages.size());
+			m_LockFreeItems.Push(pFirst, pLast);
 		}
+
+		return pResult;
 	}
 
 
-	bool MemoryPoolBucket::CheckIfAddressIsWithinPages(void* p) const
+	MemoryPoolSlab* MemoryPoolBucket::CreatePage(int& slabsCount)
+	{
+		//threads growing a lock-free bucket at the same time may add a page each, the spare items just stay in the stack
+		bool pageIsExtra = m_pPages.load(std::memory_order_relaxed) != nullptr;
+		int itemsCount = pageIsExtra ? GetNextExtraPageItemsCount() : m_FirstPageItemsCount;
+
+		auto pPage = PreparePage(itemsCount, slabsCount);
+		pPage->m_IsExtraPage = pageIsExtra;
+
+		LinkPage(pPage, slabsCount);
+
+		return pPage;
+	}
+
+
+	//the page memory is set up and registered in the page map, the bucket itself isn't touched
+	MemoryPoolSlab* MemoryPoolBucket::PreparePage(int itemsCount, int& slabsCount)
+	{
+		//the page map leaves allocate
+		MemoryPoolInternalScope scope;
+
+		slabsCount = GetPageSlabsCount(itemsCount);
+
+		auto pPageMemory = static_cast<char*>(AllocatePageMemory(slabsCount * MemoryPoolSlab::SlabSize));
+		auto pPage = reinterpret_cast<MemoryPoolSlab*>(pPageMemory);
+
+		for (int i = 0; i < slabsCount; i++)
+		{
+			auto pSlab = reinterpret_cast<MemoryPoolSlab*>(pPageMemory + i * MemoryPoolSlab::SlabSize);
+			pSlab->Setup(this, pPage, m_ItemSize);
+		}
+
+		pPage->m_PageSlabsCount = slabsCount;
+		pPage->m_IsExtraPage = true;
+
+		MemoryPoolPageMap::Register(pPage, slabsCount);
+
+		return pPage;
+	}
+
+
+	void MemoryPoolBucket::LinkPage(MemoryPoolSlab* pPage, int slabsCount)
+	{
+		//the logging allocates
+		MemoryPoolInternalScope scope;
+
+		auto pNextPage = m_pPages.load(std::memory_order_relaxed);
+
+		do
+		{
+			pPage->m_pNextPage = pNextPage;
+		}
+		while (!m_pPages.compare_exchange_weak(pNextPage, pPage, std::memory_order_release, std::memory_order_relaxed));
+
+		int pagesCount = ++m_PagesCount;
+		m_TotalItemsCount += slabsCount * MemoryPoolSlab::GetItemsCapacity(m_ItemSize);
+
+		if (m_IsLockFree == false)
+		{
+			UpdateProvisioningWatermark();
+		}
+
+		if (pPage->m_IsExtraPage)
+		{
+			spdlog::debug("Memory pool: adding extra page of {} slabs for item size [{}], new pages count: [{}].", slabsCount, m_ItemSize, pagesCount);
+		}
+	}
+
+
+	//the page is rounded up to whole slabs, huge pages backed ones to whole huge pages
+	int MemoryPoolBucket::GetPageSlabsCount(int itemsCount) const
+	{
+		int slabItemsCount = MemoryPoolSlab::GetItemsCapacity(m_ItemSize);
+		int slabsCount = (itemsCount + slabItemsCount - 1) / slabItemsCount;
+
+		if (m_PageBacking == MemoryPoolPageBacking::HugePages)
+		{
+			constexpr int hugePageSlabsCount = (int)(HugePageSize / MemoryPoolSlab::SlabSize);
+			slabsCount = (slabsCount + hugePageSlabsCount - 1) / hugePageSlabsCount * hugePageSlabsCount;
+		}
+
+		return slabsCount;
+	}
+
+
+	//every extra page the bucket has doubles the next one, freed pages bring it back down
+	int MemoryPoolBucket::GetNextExtraPageItemsCount() const
+	{
+		int extraPagesCount = std::max(m_PagesCount.load(std::memory_order_relaxed) - 1, 0);
+		int64_t itemsCount = m_ExtraPageItemsCount;
+
+		for (int i = 0; i < extraPagesCount && itemsCount < m_MaxExtraPageItemsCount; i++)
+		{
+			itemsCount *= 2;
+		}
+
+		return (int)std::min(itemsCount, (int64_t)m_MaxExtraPageItemsCount);
+	}
+
+
+	void MemoryPoolBucket::UpdateProvisioningWatermark()
+	{
+		m_ProvisioningWatermark = GetPageSlabsCount(GetNextExtraPageItemsCount()) * MemoryPoolSlab::GetItemsCapacity(m_ItemSize) / 2;
+	}
+
+
+	void MemoryPoolBucket::DoReclaimRemoteItems()
+	{
+		void* pItem = m_RemoteFreeItems.PopAll();
+
+		while (pItem != nullptr)
+		{
+			//the link is overwritten by Deallocate
+			void* pNextItem = *static_cast<void**>(pItem);
+			Deallocate(pItem);
+			pItem = pNextItem;
+		}
+	}
+
+
+	void MemoryPoolBucket::OnSlabEmptied(MemoryPoolSlab* pSlab)
+	{
+		auto pPage = pSlab->m_pPage;
+
+		pPage->m_PageEmptySlabsCount++;
+
+		if (pPage->IsPageEmpty() == false || pPage->m_IsExtraPage == false)
+		{
+			return;
+		}
+
+		m_EmptyExtraPagesCount++;
+
+		if (m_RetainedEmptyPagesCount != MemoryPoolSettings::RetainAllEmptyPages && m_EmptyExtraPagesCount > m_RetainedEmptyPagesCount)
+		{
+			FreePage(pPage);
+		}
+	}
+
+
+	size_t MemoryPoolBucket::Trim(int retainedEmptyPagesCount)
 	{
-		auto pagesCount = m_Pages.size();
+		assert(retainedEmptyPagesCount >= 0);
 
-		for (int i = 0; i < pagesCount; i++)
+		if (m_IsLockFree)
 		{
-			int pageSize = GetPageSize(i == 0);
+			return 0;
+		}
+
+		ReclaimRemoteItems();
+
+		size_t result = 0;
+		int retainedPagesCount = 0;
 
-			auto pPage = m_Pages[i];
+		auto pPage = m_pPages.load(std::memory_order_relaxed);
 
-			if (p >= pPage && p < static_cast<char*>(pPage) + pageSize)
+		while (pPage != nullptr)
+		{
+			auto pNextPage = pPage->m_pNextPage;
+
+			if (pPage->IsPageEmpty())
 			{
-				return true;
+				if (pPage->m_IsExtraPage && retainedPagesCount >= retainedEmptyPagesCount)
+				{
+					result += FreePage(pPage);
+				}
+				else
+				{
+					result += DecommitPage(pPage);
+
+					if (pPage->m_IsExtraPage)
+					{
+						retainedPagesCount++;
+					}
+				}
 			}
+
+			pPage = pNextPage;
+		}
+
+		return result;
+	}
+
+
+	size_t MemoryPoolBucket::Reset()
+	{
+		assert(m_IsLockFree == false);
+
+		//remote frees of the dropped items are dropped with them
+		[[maybe_unused]] void* pDroppedItems = m_RemoteFreeItems.PopAll();
+
+		size_t result = 0;
+		auto pPage = m_pPages.load(std::memory_order_relaxed);
+
+		while (pPage != nullptr)
+		{
+			auto pNextPage = pPage->m_pNextPage;
+			int slabsCount = pPage->m_PageSlabsCount;
+
+			MemoryPoolPageMap::Unregister(pPage, slabsCount);
+			FreePageMemory(pPage, slabsCount * MemoryPoolSlab::SlabSize);
+
+			result += slabsCount * MemoryPoolSlab::SlabSize;
+			pPage = pNextPage;
 		}
 
-		return false;
+		m_pPages.store(nullptr, std::memory_order_relaxed);
+		m_pAvailableSlabs = nullptr;
+
+		m_PagesCount = 0;
+		m_EmptyExtraPagesCount = 0;
+		m_TotalItemsCount = 0;
+		m_FreeItemsCount = 0;
+
+		UpdateProvisioningWatermark();
+
+		return result;
 	}
 
 
-	int MemoryPoolBucket::GetTotalItemsCount() const
+	size_t MemoryPoolBucket::FreePage(MemoryPoolSlab* pPage)
 	{
-		int result = 0;
+		assert(m_IsLockFree == false);
+		assert(pPage->m_IsExtraPage);
+		assert(pPage->IsPageEmpty());
 
-		auto pagesCount = m_Pages.size();
+		int slabsCount = pPage->m_PageSlabsCount;
 
-		if (pagesCount > 0)
+		//empty slabs are always available
+		for (int i = 0; i < slabsCount; i++)
 		{
-			result += m_FirstPageItemsCount;
+			auto pSlab = reinterpret_cast<MemoryPoolSlab*>(reinterpret_cast<char*>(pPage) + i * MemoryPoolSlab::SlabSize);
+			RemoveAvailableSlab(pSlab);
 		}
 
-		if (pagesCount > 1)
+		//unlinking the page, the list is only shared by lock-free buckets
+		MemoryPoolSlab* pPrevPage = nullptr;
+		auto pCurrentPage = m_pPages.load(std::memory_order_relaxed);
+
+		while (pCurrentPage != pPage)
 		{
-			result += (pagesCount - 1) * m_ExtraPageItemsCount;
+			assert(pCurrentPage != nullptr);
+
+			pPrevPage = pCurrentPage;
+			pCurrentPage = pCurrentPage->m_pNextPage;
+		}
+
+		if (pPrevPage == nullptr)
+		{
+			m_pPages.store(pPage->m_pNextPage, std::memory_order_relaxed);
+		}
+		else
+		{
+			pPrevPage->m_pNextPage = pPage->m_pNextPage;
+		}
+
+		int itemsCount = slabsCount * MemoryPoolSlab::GetItemsCapacity(m_ItemSize);
+
+		m_PagesCount--;
+		m_TotalItemsCount -= itemsCount;
+		m_FreeItemsCount -= itemsCount;
+		m_EmptyExtraPagesCount--;
+
+		UpdateProvisioningWatermark();
+
+		MemoryPoolPageMap::Unregister(pPage, slabsCount);
+		FreePageMemory(pPage, slabsCount * MemoryPoolSlab::SlabSize);
+
+		return slabsCount * MemoryPoolSlab::SlabSize;
+	}
+
+
+	size_t MemoryPoolBucket::DecommitPage(MemoryPoolSlab* pPage)
+	{
+		assert(pPage->IsPageEmpty());
+
+		size_t result = 0;
+
+		for (int i = 0; i < pPage->m_PageSlabsCount; i++)
+		{
+			auto pSlab = reinterpret_cast<MemoryPoolSlab*>(reinterpret_cast<char*>(pPage) + i * MemoryPoolSlab::SlabSize);
+
+			//only the carved part of a slab has ever been touched
+			char* pStart = pSlab->GetItemsStart();
+			char* pEnd = pSlab->m_pUncarved;
+
+			if (pEnd == pStart)
+			{
+				continue;
+			}
+
+			pSlab->ResetItems();
+			result += DecommitMemory(pStart, pEnd);
 		}
 
 		return result;
 	}
 
 
+	void MemoryPoolBucket::CheckDeallocation(void* p) const
+	{
+		//check that the address is within pages
+		assert(CheckIfAddressIsWithinPages(p) == true);
+
+		auto pSlab = MemoryPoolSlab::FromPointer(p);
+
+		//check that the address is an item that was handed out
+		assert(pSlab->ContainsItem(p) == true);
+
+#ifndef MEMORY_POOL_CHECKED
+		//check that the address is not already in the free list (the checked mode does it in O(1) with the item states)
+		assert(pSlab->IsInFreeList(p) == false);
+#endif
+	}
+
+
+	//the page map lookup is O(1), whatever the amount of pages
+	bool MemoryPoolBucket::CheckIfAddressIsWithinPages(void* p) const
+	{
+		return MemoryPoolPageMap::Contains(p) && MemoryPoolSlab::FromPointer(p)->m_pBucket == this;
+	}
+
+
+	int MemoryPoolBucket::GetPagesCount() const
+	{
+		return m_PagesCount;
+	}
+
+
+	int MemoryPoolBucket::GetEmptyExtraPagesCount() const
+	{
+		return m_EmptyExtraPagesCount;
+	}
+
+
+	int MemoryPoolBucket::GetTotalItemsCount() const
+	{
+		return m_TotalItemsCount;
+	}
+
+
 	int MemoryPoolBucket::GetFreeItemsCount() const
 	{
-		return (int)m_Items.size();
+		if (m_IsLockFree)
+		{
+			return m_LockFreeItems.GetItemsCount();
+		}
+
+		return m_FreeItemsCount;
 	}
 
 
@@ -193,9 +666,135 @@ namespace st::memory
 	}
 
 
-	int MemoryPoolBucket::GetAlignment([[maybe_unused]] int itemSize)
+	void* MemoryPoolBucket::AllocatePageMemory(size_t size) const
 	{
-		return sizeof(std::max_align_t);
+		void* pResult = nullptr;
+
+#ifdef _WIN32
+		//later: VirtualAlloc backed pages (MEM_LARGE_PAGES for huge pages)
+		pResult = _aligned_malloc(size, MemoryPoolSlab::SlabSize);
+#else
+		switch (m_PageBacking)
+		{
+			case MemoryPoolPageBacking::Heap:
+				pResult = std::aligned_alloc(MemoryPoolSlab::SlabSize, size);
+				break;
+
+			case MemoryPoolPageBacking::Mmap:
+				pResult = MapMemory(size, MemoryPoolSlab::SlabSize);
+				break;
+
+			case MemoryPoolPageBacking::HugePages:
+			{
+				assert(size % HugePageSize == 0);
+
+#ifdef MAP_HUGETLB
+				//explicit huge pages are only there if the system has them reserved (vm.nr_hugepages)
+				pResult = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+				if (pResult != MAP_FAILED)
+				{
+					assert(reinterpret_cast<uintptr_t>(pResult) % MemoryPoolSlab::SlabSize == 0);
+					break;
+				}
+#endif
+
+				pResult = MapMemory(size, HugePageSize);
+
+#ifdef MADV_HUGEPAGE
+				if (pResult != nullptr)
+				{
+					madvise(pResult, size, MADV_HUGEPAGE);
+				}
+#endif
+				break;
+			}
+		}
+#endif
+
+		assert(pResult != nullptr);
+
+		return pResult;
+	}
+
+
+	void MemoryPoolBucket::FreePageMemory(void* p, [[maybe_unused]] size_t size) const
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		if (m_PageBacking == MemoryPoolPageBacking::Heap)
+		{
+			std::free(p);
+		}
+		else
+		{
+			munmap(p, size);
+		}
+#endif
+	}
+
+
+	//mmap only guarantees system page alignment: the mapping is over-reserved by the alignment, then the unaligned head and the tail are unmapped
+	void* MemoryPoolBucket::MapMemory([[maybe_unused]] size_t size, [[maybe_unused]] size_t alignment)
+	{
+#ifdef _WIN32
+		return nullptr;
+#else
+		size_t reservedSize = size + alignment;
+
+		void* pReserved = mmap(nullptr, reservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (pReserved == MAP_FAILED)
+		{
+			spdlog::error("Memory pool: failed to map {} bytes for a page", reservedSize);
+			return nullptr;
+		}
+
+		auto reservedStart = reinterpret_cast<uintptr_t>(pReserved);
+		auto reservedEnd = reservedStart + reservedSize;
+		auto start = (reservedStart + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		auto end = start + size;
+
+		if (start > reservedStart)
+		{
+			munmap(pReserved, start - reservedStart);
+		}
+
+		if (reservedEnd > end)
+		{
+			munmap(reinterpret_cast<void*>(end), reservedEnd - end);
+		}
+
+		return reinterpret_cast<void*>(start);
+#endif
+	}
+
+
+	//the memory stays mapped and reads as zeroes once touched again, only whole system pages inside of the range are decommitted
+	size_t MemoryPoolBucket::DecommitMemory([[maybe_unused]] char* pStart, [[maybe_unused]] char* pEnd)
+	{
+#ifdef __linux__
+		static const auto systemPageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+		auto start = (reinterpret_cast<uintptr_t>(pStart) + systemPageSize - 1) & ~(systemPageSize - 1);
+		auto end = reinterpret_cast<uintptr_t>(pEnd) & ~(systemPageSize - 1);
+
+		if (end <= start)
+		{
+			return 0;
+		}
+
+		if (madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED) != 0)
+		{
+			return 0;
+		}
+
+		return end - start;
+#else
+		//later: VirtualAlloc(MEM_RESET) on windows, MADV_FREE on other posix systems
+		return 0;
+#endif
 	}
 
 
@@ -4,8 +4,10 @@
 
 #pragma once
 
-#include <vector>
 #include "memory_pool_settings.h"
+#include "memory_pool_slab.h"
+#include "memory_pool_lock_free_stack.h"
+#include <atomic>
 
 
 namespace st::memory
@@ -13,18 +15,155 @@ namespace st::memory
 
 	class MemoryPoolBucket
 	{
-		//later: *potential* performance increase to have m_CachedItems along with m_Items for data locality
-
 	public:
 
 		MemoryPoolBucket();
 		~MemoryPoolBucket();
 
-		void Setup(const MemoryPoolSettings::BucketDefinition& bucketDefinition);
+		//lock-free buckets are only used through AllocateLockFree/DeallocateLockFree
+		//retainedEmptyPagesCount: empty extra pages above this count are freed as soon as they get empty (RetainAllEmptyPages to keep them)
+		//maxExtraPageSize: extra pages double with every extra page the bucket has, up to this many bytes (0 for fixed size extra pages)
+		void Setup(const MemoryPoolSettings::BucketDefinition& bucketDefinition, bool isLockFree = false, int retainedEmptyPagesCount = MemoryPoolSettings::RetainAllEmptyPages, size_t maxExtraPageSize = 0);
+
+		[[nodiscard]] inline void* Allocate()
+		{
+			if (m_pAvailableSlabs == nullptr)
+			{
+				AddPage();
+			}
+
+			auto pSlab = m_pAvailableSlabs;
+
+			assert(pSlab != nullptr);
+
+			if (pSlab->IsEmpty())
+			{
+				OnSlabUsed(pSlab);
+			}
+
+			void* pResult = pSlab->Allocate();
+			m_FreeItemsCount--;
+
+			if (pSlab->IsFull())
+			{
+				RemoveAvailableSlab(pSlab);
+			}
+
+			return pResult;
+		}
+
+		inline void Deallocate(void* p)
+		{
+#ifdef MEMORY_POOL_CHECK_ADDRESS_BOUNDS
+			CheckDeallocation(p);
+#endif
+
+			auto pSlab = MemoryPoolSlab::FromPointer(p);
+
+			assert(pSlab->m_pBucket == this);
+
+			bool wasFull = pSlab->IsFull();
+
+			pSlab->Deallocate(p);
+			m_FreeItemsCount++;
+
+			//the slab that just got a (cache-hot) item back is used first
+			if (wasFull)
+			{
+				AddAvailableSlab(pSlab);
+			}
+
+			if (pSlab->IsEmpty())
+			{
+				OnSlabEmptied(pSlab);
+			}
+
+			assert(GetFreeItemsCount() <= GetTotalItemsCount());
+		}
+
+		//batch variants: count items of this bucket in one call
+		//allocation takes whole runs of items from a slab, updating the bucket counters once per slab
+		//deallocation returns runs of consecutive items of the same slab together
+		void AllocateBatch(void** pOut, int count);
+		void DeallocateBatch(void** pItems, int count);
+
+		//lock-free variants, safe to call from any thread without external synchronization
+		//free items are kept in a single bucket wide stack instead of the per slab free lists
+		[[nodiscard]] inline void* AllocateLockFree()
+		{
+			assert(m_IsLockFree);
+
+			void* pResult = m_LockFreeItems.Pop();
+
+			if (pResult != nullptr)
+			{
+				return pResult;
+			}
+
+			return AddPageLockFree();
+		}
+
+		inline void DeallocateLockFree(void* p)
+		{
+			assert(m_IsLockFree);
+
+#ifdef MEMORY_POOL_CHECK_ADDRESS_BOUNDS
+			assert(CheckIfAddressIsWithinPages(p) == true);
+			assert(MemoryPoolSlab::FromPointer(p)->m_pBucket == this);
+#endif
+
+			m_LockFreeItems.Push(p);
+		}
+
+		//the stack gives out one item per exchange, batch deallocation links the items and pushes them at once
+		void AllocateBatchLockFree(void** pOut, int count);
+		void DeallocateBatchLockFree(void** pItems, int count);
+
+		//pFirst..pLast is a chain already linked through the items (each item's first bytes point to the next one)
+		inline void DeallocateChainLockFree(void* pFirst, void* pLast)
+		{
+			assert(m_IsLockFree);
+
+			m_LockFreeItems.Push(pFirst, pLast);
+		}
+
+		//remote frees: a bucket that is owned by one thread receives deallocations from other threads through this lock-free list
+		//the owner moves them back to the slab free lists in one batch
+		inline void DeallocateRemote(void* p)
+		{
+			m_RemoteFreeItems.Push(p);
+		}
+
+		inline void ReclaimRemoteItems()
+		{
+			if (m_RemoteFreeItems.IsEmpty() == false)
+			{
+				DoReclaimRemoteItems();
+			}
+		}
+
+		//empty extra pages above retainedEmptyPagesCount are freed, the first page is never freed
+		//the retained ones (and the first page, if it's empty) are decommitted: their items memory goes back to the system, the address range stays reserved
+		//not supported for lock-free buckets, their free items are not tracked per page. Returns the amount of bytes freed or decommitted
+		size_t Trim(int retainedEmptyPagesCount);
+
+		//every item is dropped and every page is freed at once, the bucket is left as it was after Setup (without the pre-warmed page)
+		//not supported for lock-free buckets. Returns the amount of bytes freed
+		size_t Reset();
+
+		//whatever owns the bucket (a pool instance), found from an item through its slab
+		inline void SetOwner(void* pOwner)
+		{
+			m_pOwner = pOwner;
+		}
 
-		[[nodiscard]] void* Allocate();
-		void Deallocate(void* p);
+		[[nodiscard]] inline void* GetOwner() const
+		{
+			return m_pOwner;
+		}
 
+		[[nodiscard]] int GetPagesCount() const;
+		[[nodiscard]] int GetEmptyExtraPagesCount() const;
 		[[nodiscard]] int GetTotalItemsCount() const;
 		[[nodiscard]] int GetFreeItemsCount() const;
 		[[nodiscard]] int GetTotalMemoryUsed() const;
@@ -33,33 +172,120 @@ namespace st::memory
 			return m_ItemSize;
 		}
 
+		//every item of the bucket is aligned at least by this
+		[[nodiscard]] inline int GetAlignment() const
+		{
+			return GetPoolItemAlignment(m_ItemSize);
+		}
+
+		//the common huge page size of x64 and arm64 systems
+		static constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+		//items count the next extra page is created for, before rounding to whole slabs
+		[[nodiscard]] int GetNextExtraPageItemsCount() const;
+
+		//background provisioning of mutex synchronized buckets: the bucket is low once its free items drop below a half of the next extra page
+		//the page is created without the lock (PreparePage is safe to call concurrently with the bucket use),
+		//then added under it. The first page is still created by the first allocation
+		[[nodiscard]] inline bool NeedsProvisioning() const
+		{
+			assert(m_IsLockFree == false);
+			return m_PagesCount.load(std::memory_order_relaxed) > 0 && m_FreeItemsCount < m_ProvisioningWatermark;
+		}
+
+		[[nodiscard]] MemoryPoolSlab* PreparePage(int itemsCount, int& slabsCount);
+		void AddPreparedPage(MemoryPoolSlab* pPage, int slabsCount);
+
 	private:
 
 		void AddPage();
+		void DoReclaimRemoteItems();
+		void* AddPageLockFree();
+		MemoryPoolSlab* CreatePage(int& slabsCount);
+		void LinkPage(MemoryPoolSlab* pPage, int slabsCount);
+		void MakePageAvailable(MemoryPoolSlab* pPage, int slabsCount);
+		[[nodiscard]] int GetPageSlabsCount(int itemsCount) const;
+		void UpdateProvisioningWatermark();
+		void OnSlabEmptied(MemoryPoolSlab* pSlab);
+		size_t FreePage(MemoryPoolSlab* pPage);
+		size_t DecommitPage(MemoryPoolSlab* pPage);
 
-		bool CheckIfAddressIsWithinPages (void* p) const;
+		//page empty slabs accounting, the empty extra pages count drives the release of extra pages
+		inline void OnSlabUsed(MemoryPoolSlab* pSlab)
+		{
+			auto pPage = pSlab->m_pPage;
+
+			if (pPage->IsPageEmpty() && pPage->m_IsExtraPage)
+			{
+				m_EmptyExtraPagesCount--;
+			}
+
+			pPage->m_PageEmptySlabsCount--;
+		}
+
+		inline void AddAvailableSlab(MemoryPoolSlab* pSlab)
+		{
+			pSlab->m_pPrevAvailable = nullptr;
+			pSlab->m_pNextAvailable = m_pAvailableSlabs;
+
+			if (m_pAvailableSlabs != nullptr)
+			{
+				m_pAvailableSlabs->m_pPrevAvailable = pSlab;
+			}
+
+			m_pAvailableSlabs = pSlab;
+		}
 
-		[[nodiscard]] inline int GetPageSize(bool isFirst) const
+		inline void RemoveAvailableSlab(MemoryPoolSlab* pSlab)
 		{
-			if (isFirst)
+			if (pSlab->m_pPrevAvailable != nullptr)
 			{
-				return m_FirstPageItemsCount * m_ItemSize;
+				pSlab->m_pPrevAvailable->m_pNextAvailable = pSlab->m_pNextAvailable;
 			}
 			else
 			{
-				return m_ExtraPageItemsCount * m_ItemSize;
+				assert(m_pAvailableSlabs == pSlab);
+				m_pAvailableSlabs = pSlab->m_pNextAvailable;
+			}
+
+			if (pSlab->m_pNextAvailable != nullptr)
+			{
+				pSlab->m_pNextAvailable->m_pPrevAvailable = pSlab->m_pPrevAvailable;
 			}
+
+			pSlab->m_pNextAvailable = nullptr;
+			pSlab->m_pPrevAvailable = nullptr;
 		}
 
-		[[maybe_unused]]
-		static int GetAlignment([[maybe_unused]] int itemSize);
+		void CheckDeallocation(void* p) const;
+		bool CheckIfAddressIsWithinPages (void* p) const;
+
+		void* AllocatePageMemory(size_t size) const;
+		void FreePageMemory(void* p, size_t size) const;
+		static void* MapMemory(size_t size, size_t alignment);
+		static size_t DecommitMemory(char* pStart, char* pEnd);
 
 		int m_ItemSize;
 		int m_FirstPageItemsCount;
 		int m_ExtraPageItemsCount;
+		int m_MaxExtraPageItemsCount;
+		int m_ProvisioningWatermark;
+
+		MemoryPoolPageBacking m_PageBacking;
+		bool m_IsLockFree;
+		int m_RetainedEmptyPagesCount;
+
+		std::atomic<int> m_PagesCount;
+		int m_EmptyExtraPagesCount;
+		std::atomic<int> m_TotalItemsCount;
+		int m_FreeItemsCount;
+
+		std::atomic<MemoryPoolSlab*> m_pPages;
+		MemoryPoolSlab* m_pAvailableSlabs;
+		MemoryPoolLockFreeStack m_LockFreeItems;
+		MemoryPoolLockFreeStack m_RemoteFreeItems;
 
-		std::vector<void*> m_Pages;
-		std::vector<void*> m_Items;
+		void* m_pOwner;
 	};
 
 }
@@ -0,0 +1,215 @@
+//
+// Created by Alexander on 04.11.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include "memory_settings.h"
+#include "memory_pool_slab.h"
+#include "memory_pool_page_map.h"
+#include "spdlog/spdlog.h"
+
+#ifdef MEMORY_POOL_CHECKED
+
+namespace st::memory
+{
+	//-----
+	//checked mode (MEMORY_POOL_CHECKED): every pooled item has a state byte in its slab, so a free is validated in O(1),
+	//whatever the amount of items and pages. Freed items are poisoned and held in a quarantine FIFO before they go back to their buckets,
+	//the unused tail of an item (item size above the requested size) is filled with a canary. Checked on the way:
+	// * freeing a pointer that is not a live item: double frees, frees of never allocated or misaligned pointers, frees to a wrong bucket
+	// * writes past the requested size: the canary is checked by sized frees
+	// * writes after free: the poison is checked when an item leaves the quarantine, and (but for the free list link) when it's allocated again
+	//failures are logged and counted, invalid frees are ignored, so the checked mode can run on live traffic
+	//-----
+	class MemoryPoolChecks final
+	{
+	public:
+
+		MemoryPoolChecks() = delete;
+
+		enum ItemState : uint8_t
+		{
+			Unused = 0,		//never handed out since the slab items were (re)carved
+			Live,
+			Quarantined,	//freed, poisoned, not returned to the bucket yet
+			Freed			//returned to the bucket, poisoned but the free list link
+		};
+
+		static constexpr uint8_t PoisonByte = 0xDD;
+		static constexpr uint8_t CanaryByte = 0xCA;
+
+		//the item has just been taken from a bucket
+		static void OnAllocate(void* p, size_t size)
+		{
+			auto pSlab = MemoryPoolSlab::FromPointer(p);
+			auto& state = pSlab->GetItemStates()[pSlab->GetItemIndex(p)];
+			auto pItem = static_cast<uint8_t*>(p);
+
+			if (state == Live || state == Quarantined)
+			{
+				ReportFailure("item handed out while in use", p, pSlab->m_ItemSize);
+			}
+			else if (state == Freed && IsFilled(pItem + sizeof(void*), pItem + pSlab->m_ItemSize, PoisonByte) == false)
+			{
+				ReportFailure("write after free", p, pSlab->m_ItemSize);
+			}
+
+			state = Live;
+
+			if (size < (size_t)pSlab->m_ItemSize)
+			{
+				std::memset(pItem + size, CanaryByte, pSlab->m_ItemSize - size);
+			}
+		}
+
+		//false for invalid frees, the item is not to be touched then. Valid items are poisoned and marked as quarantined
+		//size is 0 for size-free deallocation, the canary is not checked then
+		static bool OnDeallocate(void* p, size_t size, int expectedItemSize)
+		{
+			if (MemoryPoolPageMap::Contains(p) == false)
+			{
+				ReportFailure("free of a pointer that is not pooled", p, expectedItemSize);
+				return false;
+			}
+
+			auto pSlab = MemoryPoolSlab::FromPointer(p);
+			auto pItem = static_cast<uint8_t*>(p);
+			auto offset = pItem - reinterpret_cast<uint8_t*>(pSlab->GetItemsStart());
+
+			if (pSlab->m_ItemSize != expectedItemSize)
+			{
+				ReportFailure("free to a wrong bucket (size mismatch)", p, pSlab->m_ItemSize);
+				return false;
+			}
+
+			if (offset < 0 || offset % pSlab->m_ItemSize != 0 || offset / pSlab->m_ItemSize >= pSlab->m_ItemsCount)
+			{
+				ReportFailure("free of a pointer that is not an item start", p, pSlab->m_ItemSize);
+				return false;
+			}
+
+			auto& state = pSlab->GetItemStates()[offset / pSlab->m_ItemSize];
+
+			if (state != Live)
+			{
+				ReportFailure(state == Unused ? "free of a never allocated item" : "double free", p, pSlab->m_ItemSize);
+				return false;
+			}
+
+			if (size != 0 && size < (size_t)pSlab->m_ItemSize && IsFilled(pItem + size, pItem + pSlab->m_ItemSize, CanaryByte) == false)
+			{
+				ReportFailure("write past the requested size", p, pSlab->m_ItemSize);
+			}
+
+			state = Quarantined;
+			std::memset(pItem, PoisonByte, pSlab->m_ItemSize);
+
+			return true;
+		}
+
+		//the item leaves the quarantine for its bucket
+		static void OnRelease(void* p)
+		{
+			auto pSlab = MemoryPoolSlab::FromPointer(p);
+			auto pItem = static_cast<uint8_t*>(p);
+
+			if (IsFilled(pItem, pItem + pSlab->m_ItemSize, PoisonByte) == false)
+			{
+				ReportFailure("write after free", p, pSlab->m_ItemSize);
+			}
+
+			pSlab->GetItemStates()[pSlab->GetItemIndex(p)] = Freed;
+		}
+
+		[[nodiscard]] static int GetFailuresCount()
+		{
+			return s_FailuresCount.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		static inline bool IsFilled(const uint8_t* pStart, const uint8_t* pEnd, uint8_t value)
+		{
+			for (auto p = pStart; p < pEnd; p++)
+			{
+				if (*p != value)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		static void ReportFailure(const char* pMessage, void* p, int itemSize)
+		{
+			s_FailuresCount.fetch_add(1, std::memory_order_relaxed);
+			spdlog::error("Memory pool check: {}, pointer {}, item size {}", pMessage, p, itemSize);
+		}
+
+		static inline std::atomic<int> s_FailuresCount = 0;
+	};
+
+
+	//FIFO of the freed items on their way back to the buckets, the oldest item leaves when a new one comes to a full quarantine
+	class MemoryPoolQuarantine final
+	{
+	public:
+
+		static constexpr int ItemsCount = 1024;
+
+		struct Item
+		{
+			void* m_pPointer;
+			int m_BucketIndex;
+		};
+
+		//the item that left the quarantine, m_pPointer is nullptr if it wasn't full
+		inline Item Push(Item item)
+		{
+			if (m_Count < ItemsCount)
+			{
+				m_Items[(m_Start + m_Count) % ItemsCount] = item;
+				m_Count++;
+
+				return {nullptr, 0};
+			}
+
+			Item result = m_Items[m_Start];
+
+			m_Items[m_Start] = item;
+			m_Start = (m_Start + 1) % ItemsCount;
+
+			return result;
+		}
+
+		//the oldest item, m_pPointer is nullptr if the quarantine is empty
+		inline Item Pop()
+		{
+			if (m_Count == 0)
+			{
+				return {nullptr, 0};
+			}
+
+			Item result = m_Items[m_Start];
+
+			m_Start = (m_Start + 1) % ItemsCount;
+			m_Count--;
+
+			return result;
+		}
+
+	private:
+
+		Item m_Items[ItemsCount] = {};
+		int m_Start = 0;
+		int m_Count = 0;
+	};
+}
+
+#endif
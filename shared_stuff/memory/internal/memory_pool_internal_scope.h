@@ -0,0 +1,74 @@
+//
+// Created by Alexander on 24.10.2021.
+//
+
+#pragma once
+
+namespace st::memory
+{
+	//-----
+	//marks the calling thread as being inside of a memory pool while it holds the pool locks or changes its containers
+	//the global operator new replacement doesn't re-enter the pool from there: nested requests (logging, containers growth) go to the system allocator
+	//-----
+	class MemoryPoolInternalScope final
+	{
+	public:
+
+		MemoryPoolInternalScope()
+		{
+			s_Depth++;
+		}
+
+		~MemoryPoolInternalScope()
+		{
+			s_Depth--;
+		}
+
+		MemoryPoolInternalScope(const MemoryPoolInternalScope&) = delete;
+		MemoryPoolInternalScope& operator=(const MemoryPoolInternalScope&) = delete;
+
+		[[nodiscard]] static inline bool IsActive()
+		{
+			return s_Depth > 0;
+		}
+
+	private:
+
+		static inline thread_local int s_Depth = 0;
+	};
+
+
+	//-----
+	//per thread object of a memory pool, created inside of the pool scope on the first access:
+	//registering a thread local destructor may allocate (some C++ runtimes do it with operator new)
+	//the destroyed object stays accessible for the thread local destructors that run after it
+	//-----
+	template<typename T> class MemoryPoolThreadLocal final
+	{
+	public:
+
+		MemoryPoolThreadLocal() = delete;
+
+		[[nodiscard]] static inline T& Get()
+		{
+			if (s_pObject == nullptr)
+			{
+				s_pObject = Create();
+			}
+
+			return *s_pObject;
+		}
+
+	private:
+
+		static T* Create()
+		{
+			MemoryPoolInternalScope scope;
+
+			static thread_local T object;
+			return &object;
+		}
+
+		static inline thread_local T* s_pObject = nullptr;
+	};
+}
@@ -0,0 +1,242 @@
+//
+// Created by Alexander on 05.11.2021.
+//
+
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include "memory_pool_leak_tracker.h"
+#include "memory_pool_internal_scope.h"
+#include "spdlog/spdlog.h"
+
+#ifndef _WIN32
+#include <execinfo.h>
+#endif
+
+namespace st::memory
+{
+
+	MemoryPoolLeakTracker::MemoryPoolLeakTracker(int sampleInterval) :
+			m_SampleInterval(sampleInterval),
+			m_LiveAllocationsCount(0),
+			m_Shards(),
+			m_CallSitesMutex(),
+			m_CallSites()
+	{
+		assert(m_SampleInterval > 0);
+	}
+
+
+	MemoryPoolLeakTracker::~MemoryPoolLeakTracker()
+	{
+		//the containers nodes were allocated inside of the pool scope
+		MemoryPoolInternalScope scope;
+
+		for (auto& shard : m_Shards)
+		{
+			shard.m_Allocations.clear();
+		}
+
+		m_CallSites.clear();
+	}
+
+
+	void MemoryPoolLeakTracker::OnAllocate(void* p, size_t size)
+	{
+		//the frame of this function is skipped
+		void* frames[MaxFramesCount + 1];
+		int framesCount = 0;
+
+		MemoryPoolInternalScope scope;
+
+#ifdef _WIN32
+		//later: RtlCaptureStackBackTrace, allocations are grouped under a single empty call site until then
+#else
+		framesCount = backtrace(frames, MaxFramesCount + 1);
+#endif
+
+		CallSite* pCallSite = framesCount > 1 ? FindOrAddCallSite(frames + 1, framesCount - 1) : FindOrAddCallSite(frames, 0);
+
+		pCallSite->m_AllocationsCount.fetch_add(1, std::memory_order_relaxed);
+		pCallSite->m_Bytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+
+		auto& shard = m_Shards[GetShardIndex(p)];
+
+		{
+			std::lock_guard lock(shard.m_Mutex);
+			shard.m_Allocations[p] = {size, pCallSite};
+		}
+
+		m_LiveAllocationsCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+
+	void MemoryPoolLeakTracker::Untrack(void* p)
+	{
+		MemoryPoolInternalScope scope;
+
+		auto& shard = m_Shards[GetShardIndex(p)];
+
+		std::lock_guard lock(shard.m_Mutex);
+
+		auto search = shard.m_Allocations.find(p);
+
+		if (search == shard.m_Allocations.end())
+		{
+			return;
+		}
+
+		auto& allocation = search->second;
+
+		allocation.m_pCallSite->m_AllocationsCount.fetch_sub(1, std::memory_order_relaxed);
+		allocation.m_pCallSite->m_Bytes.fetch_sub((int64_t)allocation.m_Size, std::memory_order_relaxed);
+
+		shard.m_Allocations.erase(search);
+
+		m_LiveAllocationsCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+
+	//call sites are looked up by the hash of their frames (FNV-1a)
+	MemoryPoolLeakTracker::CallSite* MemoryPoolLeakTracker::FindOrAddCallSite(void** pFrames, int framesCount)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		for (int i = 0; i < framesCount; i++)
+		{
+			hash = (hash ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pFrames[i]))) * 1099511628211ull;
+		}
+
+		std::lock_guard lock(m_CallSitesMutex);
+
+		auto range = m_CallSites.equal_range(hash);
+
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			auto pCallSite = it->second.get();
+
+			if (pCallSite->m_FramesCount == framesCount && std::equal(pFrames, pFrames + framesCount, pCallSite->m_Frames))
+			{
+				return pCallSite;
+			}
+		}
+
+		auto pCallSite = new CallSite();
+
+		std::copy(pFrames, pFrames + framesCount, pCallSite->m_Frames);
+		pCallSite->m_FramesCount = framesCount;
+		pCallSite->m_AllocationsCount = 0;
+		pCallSite->m_Bytes = 0;
+
+		m_CallSites.emplace(hash, pCallSite);
+
+		return pCallSite;
+	}
+
+
+	std::vector<MemoryPoolLeakTracker::CallSiteReport> MemoryPoolLeakTracker::GetReport() const
+	{
+		std::vector<CallSiteReport> result;
+
+		{
+			MemoryPoolInternalScope scope;
+			std::lock_guard lock(m_CallSitesMutex);
+
+			for (auto& [hash, pCallSite] : m_CallSites)
+			{
+				auto allocationsCount = pCallSite->m_AllocationsCount.load(std::memory_order_relaxed);
+
+				if (allocationsCount > 0)
+				{
+					CallSiteReport report;
+					report.m_Frames.assign(pCallSite->m_Frames, pCallSite->m_Frames + pCallSite->m_FramesCount);
+					report.m_AllocationsCount = allocationsCount;
+					report.m_Bytes = pCallSite->m_Bytes.load(std::memory_order_relaxed);
+
+					result.push_back(std::move(report));
+				}
+			}
+		}
+
+		std::sort(result.begin(), result.end(), [](const CallSiteReport& a, const CallSiteReport& b)
+		{
+			return a.m_Bytes > b.m_Bytes;
+		});
+
+		return result;
+	}
+
+
+	void MemoryPoolLeakTracker::LogReport(const char* pPoolName) const
+	{
+		auto report = GetReport();
+
+		if (report.empty())
+		{
+			return;
+		}
+
+		int64_t allocationsCount = 0;
+		int64_t bytes = 0;
+
+		for (auto& callSite : report)
+		{
+			allocationsCount += callSite.m_AllocationsCount;
+			bytes += callSite.m_Bytes;
+		}
+
+		spdlog::warn("Memory Pool ({}) live allocations: {} sampled ({} bytes) from {} call sites, 1 in {} allocations is sampled", pPoolName, allocationsCount, bytes, report.size(), m_SampleInterval);
+
+		for (auto& callSite : report)
+		{
+			spdlog::warn("   {} allocations, {} bytes:", callSite.m_AllocationsCount, callSite.m_Bytes);
+
+			for (auto& frame : GetFramesDescriptions(callSite.m_Frames))
+			{
+				spdlog::warn("      {}", frame);
+			}
+		}
+	}
+
+
+	int MemoryPoolLeakTracker::GetSampleInterval() const
+	{
+		return m_SampleInterval;
+	}
+
+
+	int64_t MemoryPoolLeakTracker::GetLiveAllocationsCount() const
+	{
+		return m_LiveAllocationsCount.load(std::memory_order_relaxed);
+	}
+
+
+	std::vector<std::string> MemoryPoolLeakTracker::GetFramesDescriptions(const std::vector<void*>& frames)
+	{
+		std::vector<std::string> result;
+
+		if (frames.empty())
+		{
+			return result;
+		}
+
+#ifdef _WIN32
+		for (auto pFrame : frames)
+		{
+			result.push_back(fmt::format("{}", pFrame));
+		}
+#else
+		char** pSymbols = backtrace_symbols(frames.data(), (int)frames.size());
+
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			result.emplace_back(pSymbols != nullptr ? pSymbols[i] : fmt::format("{}", frames[i]));
+		}
+
+		std::free(pSymbols);
+#endif
+
+		return result;
+	}
+
+}
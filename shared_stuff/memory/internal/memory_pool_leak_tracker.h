@@ -0,0 +1,127 @@
+//
+// Created by Alexander on 05.11.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace st::memory
+{
+	//-----
+	//live allocations of a pool by call site, for finding out who allocated the unreleased pointers
+	//every SampleInterval-th allocation of a thread gets its call stack captured (the expensive part), the sampled ones are tracked until freed
+	//so the report counts sampled allocations only: multiply by the interval for an estimate (an interval of 1 tracks them all)
+	//thread safe: the live allocations are sharded by address, frees of untracked pointers cost a hash lookup in one shard
+	//the pool flags its sampled items in their slabs and only passes the frees of those (and of oversized allocations) to OnDeallocate
+	//-----
+	class MemoryPoolLeakTracker final
+	{
+	public:
+
+		static constexpr int MaxFramesCount = 16;
+
+		struct CallSiteReport
+		{
+			std::vector<void*> m_Frames;
+			int64_t m_AllocationsCount;
+			int64_t m_Bytes;
+		};
+
+		explicit MemoryPoolLeakTracker(int sampleInterval);
+		~MemoryPoolLeakTracker();
+
+		MemoryPoolLeakTracker(const MemoryPoolLeakTracker&) = delete;
+		MemoryPoolLeakTracker& operator=(const MemoryPoolLeakTracker&) = delete;
+
+		//the sampling countdown is per thread and shared by the trackers, one left from a longer interval is cut short
+		[[nodiscard]] inline bool ShouldSample()
+		{
+			if (--s_SampleCountdown > 0 && s_SampleCountdown < m_SampleInterval)
+			{
+				return false;
+			}
+
+			s_SampleCountdown = m_SampleInterval;
+			return true;
+		}
+
+		//a sampled allocation, the call stack is captured here
+		void OnAllocate(void* p, size_t size);
+
+		inline void OnDeallocate(void* p)
+		{
+			if (m_LiveAllocationsCount.load(std::memory_order_relaxed) > 0)
+			{
+				Untrack(p);
+			}
+		}
+
+		//call sites with live sampled allocations, the most bytes first
+		[[nodiscard]] std::vector<CallSiteReport> GetReport() const;
+
+		//the report with symbolized frames, nothing is logged if there are no live sampled allocations
+		void LogReport(const char* pPoolName) const;
+
+		[[nodiscard]] int GetSampleInterval() const;
+		[[nodiscard]] int64_t GetLiveAllocationsCount() const;
+
+		//the frames as text, one string per frame. Symbol names depend on the platform and the build (-rdynamic for executables on Linux)
+		[[nodiscard]] static std::vector<std::string> GetFramesDescriptions(const std::vector<void*>& frames);
+
+	private:
+
+		static constexpr int ShardsBits = 6;
+		static constexpr int ShardsCount = 1 << ShardsBits;
+
+		struct CallSite
+		{
+			void* m_Frames[MaxFramesCount];
+			int m_FramesCount;
+
+			std::atomic<int64_t> m_AllocationsCount;
+			std::atomic<int64_t> m_Bytes;
+		};
+
+		struct Allocation
+		{
+			size_t m_Size;
+			CallSite* m_pCallSite;
+		};
+
+		struct Shard
+		{
+			std::mutex m_Mutex;
+			std::unordered_map<void*, Allocation> m_Allocations;
+		};
+
+		void Untrack(void* p);
+
+		CallSite* FindOrAddCallSite(void** pFrames, int framesCount);
+
+		//fibonacci hashing: item addresses share their low bits
+		static inline int GetShardIndex(void* p)
+		{
+			return (int)((static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p)) * 0x9E3779B97F4A7C15ull) >> (64 - ShardsBits));
+		}
+
+		const int m_SampleInterval;
+
+		std::atomic<int64_t> m_LiveAllocationsCount;
+
+		Shard m_Shards[ShardsCount];
+
+		//call sites stay until the tracker is destroyed, the allocations point to them
+		mutable std::mutex m_CallSitesMutex;
+		std::unordered_multimap<uint64_t, std::unique_ptr<CallSite>> m_CallSites;
+
+		static inline thread_local int s_SampleCountdown = 1;
+	};
+}
@@ -0,0 +1,136 @@
+//
+// Created by Alexander on 21.10.2021.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+
+namespace st::memory
+{
+	//-----
+	//intrusive lock-free stack of free items (Treiber stack)
+	//the first bytes of every free item hold the next item pointer
+	//the head is a tagged pointer: every successful exchange increments the tag, which protects Pop from ABA
+	//-----
+	class MemoryPoolLockFreeStack final
+	{
+	public:
+
+		MemoryPoolLockFreeStack() : m_Head(0)
+		{
+
+		}
+
+		MemoryPoolLockFreeStack(const MemoryPoolLockFreeStack&) = delete;
+		MemoryPoolLockFreeStack& operator=(const MemoryPoolLockFreeStack&) = delete;
+
+		//pFirst..pLast is a chain that is already linked through the items
+		inline void Push(void* pFirst, void* pLast)
+		{
+			uint64_t head = m_Head.load(std::memory_order_relaxed);
+			uint64_t newHead;
+
+			do
+			{
+				*static_cast<void**>(pLast) = GetPointer(head);
+				newHead = MakeHead(pFirst, GetTag(head) + 1);
+			}
+			while (!m_Head.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		inline void Push(void* p)
+		{
+			Push(p, p);
+		}
+
+		//returns nullptr if the stack is empty
+		//the next pointer of a popped item may be read after another thread took the same item,
+		//which is fine as item memory stays mapped for the whole pool lifetime and the tag check fails the exchange
+		[[nodiscard]] inline void* Pop()
+		{
+			uint64_t head = m_Head.load(std::memory_order_acquire);
+			uint64_t newHead;
+			void* pResult;
+
+			do
+			{
+				pResult = GetPointer(head);
+
+				if (pResult == nullptr)
+				{
+					return nullptr;
+				}
+
+				//the next pointer may be stale (the item could be in use, even poisoned by the checked mode), so it's masked, not asserted:
+				//the exchange fails for a stale one anyway
+				auto nextAddress = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(*static_cast<void* volatile*>(pResult)));
+				newHead = (nextAddress & PointerMask) | ((GetTag(head) + 1) << PointerBits);
+			}
+			while (!m_Head.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire));
+
+			return pResult;
+		}
+
+		//takes the whole chain at once, no ABA issue here as nothing is read from the items
+		[[nodiscard]] inline void* PopAll()
+		{
+			uint64_t head = m_Head.load(std::memory_order_relaxed);
+
+			while (!m_Head.compare_exchange_weak(head, MakeHead(nullptr, GetTag(head) + 1), std::memory_order_acquire, std::memory_order_relaxed))
+			{
+
+			}
+
+			return GetPointer(head);
+		}
+
+		[[nodiscard]] inline bool IsEmpty() const
+		{
+			return GetPointer(m_Head.load(std::memory_order_relaxed)) == nullptr;
+		}
+
+		//not thread safe, for statistics and validation only
+		[[nodiscard]] int GetItemsCount() const
+		{
+			int result = 0;
+
+			for (void* pItem = GetPointer(m_Head.load(std::memory_order_acquire)); pItem != nullptr; pItem = *static_cast<void**>(pItem))
+			{
+				result++;
+			}
+
+			return result;
+		}
+
+	private:
+
+		//64 bit: the lower 48 bits hold the pointer (x64/arm64 user space addresses), the upper 16 bits the tag
+		//32 bit: the pointer and the tag take 32 bits each
+		static constexpr int PointerBits = sizeof(void*) == 8 ? 48 : 32;
+		static constexpr uint64_t PointerMask = (uint64_t(1) << PointerBits) - 1;
+
+		static inline uint64_t MakeHead(void* p, uint64_t tag)
+		{
+			auto address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p));
+
+			assert((address & ~PointerMask) == 0);
+
+			return address | (tag << PointerBits);
+		}
+
+		static inline void* GetPointer(uint64_t head)
+		{
+			return reinterpret_cast<void*>(static_cast<uintptr_t>(head & PointerMask));
+		}
+
+		static inline uint64_t GetTag(uint64_t head)
+		{
+			return head >> PointerBits;
+		}
+
+		std::atomic<uint64_t> m_Head;
+	};
+}
@@ -0,0 +1,61 @@
+//
+// Created by Alexander on 23.10.2021.
+//
+
+#include "memory_pool_page_map.h"
+#include <cassert>
+
+namespace st::memory
+{
+	void MemoryPoolPageMap::Register(void* pFirstSlab, int slabsCount)
+	{
+		SetSlabsState(pFirstSlab, slabsCount, SlabState::Registered);
+	}
+
+
+	void MemoryPoolPageMap::Unregister(void* pFirstSlab, int slabsCount)
+	{
+		SetSlabsState(pFirstSlab, slabsCount, SlabState::None);
+	}
+
+
+	void MemoryPoolPageMap::Orphan(void* pFirstSlab, int slabsCount)
+	{
+		SetSlabsState(pFirstSlab, slabsCount, SlabState::Orphaned);
+	}
+
+
+	void MemoryPoolPageMap::SetSlabsState(void* pFirstSlab, int slabsCount, SlabState state)
+	{
+		auto firstAddress = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pFirstSlab));
+
+		assert((firstAddress & (MemoryPoolSlab::SlabSize - 1)) == 0);
+
+		for (int i = 0; i < slabsCount; i++)
+		{
+			uint64_t address = firstAddress + (uint64_t)i * MemoryPoolSlab::SlabSize;
+
+			assert((address >> AddressBits) == 0);
+
+			auto& root = s_Root[address >> LeafShift];
+			auto pLeaf = root.load(std::memory_order_acquire);
+
+			//threads adding pages in the same range at once may both create the leaf, only one of them is kept
+			if (pLeaf == nullptr)
+			{
+				auto pNewLeaf = new Leaf();
+
+				if (root.compare_exchange_strong(pLeaf, pNewLeaf, std::memory_order_acq_rel))
+				{
+					pLeaf = pNewLeaf;
+				}
+				else
+				{
+					delete pNewLeaf;
+				}
+			}
+
+			pLeaf->m_Slabs[(address >> SlabShift) & LeafMask].store(state, std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+//
+// Created by Alexander on 23.10.2021.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "memory_pool_slab.h"
+
+namespace st::memory
+{
+	//-----
+	//process wide map of the memory pool slabs: tells pooled pointers from any other ones in O(1), without touching the pointed memory
+	//two levels: the root splits the address space into ranges of 2^LeafBits slabs, a leaf holds one flag per slab of its range
+	//leaves are created on demand and never freed (32KB per 8GB of address space that ever held slabs)
+	//-----
+	class MemoryPoolPageMap final
+	{
+	public:
+
+		MemoryPoolPageMap() = delete;
+
+		[[nodiscard]] static inline bool Contains(const void* p)
+		{
+			return GetSlabState(p) == SlabState::Registered;
+		}
+
+		//slabs of a pool released with unreleased items: their memory is kept, but they don't belong to any pool anymore
+		[[nodiscard]] static inline bool IsOrphaned(const void* p)
+		{
+			return GetSlabState(p) == SlabState::Orphaned;
+		}
+
+		//slabs are registered before any of their items is handed out, and unregistered after all of them are returned
+		static void Register(void* pFirstSlab, int slabsCount);
+		static void Unregister(void* pFirstSlab, int slabsCount);
+		static void Orphan(void* pFirstSlab, int slabsCount);
+
+	private:
+
+		static constexpr int AddressBits = sizeof(void*) == 8 ? 48 : 32;
+		static constexpr int SlabShift = 18;
+		static constexpr int LeafBits = sizeof(void*) == 8 ? 15 : AddressBits - SlabShift;
+		static constexpr int LeafShift = SlabShift + LeafBits;
+		static constexpr uint64_t LeafMask = (uint64_t(1) << LeafBits) - 1;
+		static constexpr int RootSize = 1 << (AddressBits - LeafShift);
+
+		static_assert((size_t(1) << SlabShift) == MemoryPoolSlab::SlabSize);
+
+		enum class SlabState : uint8_t
+		{
+			None,
+			Registered,
+			Orphaned
+		};
+
+		struct Leaf
+		{
+			std::atomic<SlabState> m_Slabs[1 << LeafBits];
+		};
+
+		[[nodiscard]] static inline SlabState GetSlabState(const void* p)
+		{
+			auto address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p));
+
+			if ((address >> AddressBits) != 0)
+			{
+				return SlabState::None;
+			}
+
+			auto pLeaf = s_Root[address >> LeafShift].load(std::memory_order_acquire);
+
+			return pLeaf != nullptr ? pLeaf->m_Slabs[(address >> SlabShift) & LeafMask].load(std::memory_order_relaxed) : SlabState::None;
+		}
+
+		static void SetSlabsState(void* pFirstSlab, int slabsCount, SlabState state);
+
+		static inline std::atomic<Leaf*> s_Root[RootSize] = {};
+	};
+}
@@ -0,0 +1,252 @@
+//
+// Created by Alexander on 26.10.2021.
+//
+
+#include <cstddef>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include "spdlog/spdlog.h"
+#include "memory_pool_profile.h"
+
+
+namespace st::memory
+{
+	void MemoryPoolProfile::AddSizeRequests(int32_t size, int64_t requestsTotal, int64_t requestsMax)
+	{
+		assert(size >= 0);
+
+		auto search = std::lower_bound(m_SizeRequests.begin(), m_SizeRequests.end(), size, [](const SizeRequests& sizeRequests, int32_t size)
+		{
+			return sizeRequests.m_Size < size;
+		});
+
+		if (search != m_SizeRequests.end() && search->m_Size == size)
+		{
+			search->m_RequestsTotal += requestsTotal;
+			search->m_RequestsMax = std::max(search->m_RequestsMax, requestsMax);
+		}
+		else
+		{
+			m_SizeRequests.insert(search, {size, requestsTotal, requestsMax});
+		}
+	}
+
+
+	const std::vector<MemoryPoolProfile::SizeRequests>& MemoryPoolProfile::GetSizeRequests() const
+	{
+		return m_SizeRequests;
+	}
+
+
+	bool MemoryPoolProfile::IsEmpty() const
+	{
+		return m_SizeRequests.empty();
+	}
+
+
+	bool MemoryPoolProfile::SaveToFile(const std::string& filePath) const
+	{
+		std::ofstream file(filePath);
+
+		if (file.is_open() == false)
+		{
+			spdlog::error("Memory pool profile: can't open [{}] for writing", filePath);
+			return false;
+		}
+
+		file << "# memory pool profile: size, requests total, requests max\n";
+
+		for (auto& sizeRequests : m_SizeRequests)
+		{
+			file << sizeRequests.m_Size << ' ' << sizeRequests.m_RequestsTotal << ' ' << sizeRequests.m_RequestsMax << '\n';
+		}
+
+		file.flush();
+
+		if (file.fail())
+		{
+			spdlog::error("Memory pool profile: failed writing [{}]", filePath);
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool MemoryPoolProfile::LoadFromFile(const std::string& filePath)
+	{
+		std::ifstream file(filePath);
+
+		if (file.is_open() == false)
+		{
+			spdlog::error("Memory pool profile: can't open [{}]", filePath);
+			return false;
+		}
+
+		std::string line;
+		int lineNumber = 0;
+
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+
+			if (line.empty() || line[0] == '#')
+			{
+				continue;
+			}
+
+			std::istringstream lineStream(line);
+
+			int32_t size;
+			int64_t requestsTotal;
+			int64_t requestsMax;
+
+			if (!(lineStream >> size >> requestsTotal >> requestsMax) || size < 0 || requestsTotal < 0 || requestsMax < 0)
+			{
+				spdlog::error("Memory pool profile: invalid line {} in [{}]", lineNumber, filePath);
+				return false;
+			}
+
+			AddSizeRequests(size, requestsTotal, requestsMax);
+		}
+
+		return true;
+	}
+
+
+	MemoryPoolSettings GetProfileGuidedMemoryPoolSettings(const MemoryPoolProfile& profile, bool isThreadSafe, int bucketsCount, int maxItemSize)
+	{
+		assert(bucketsCount > 0);
+
+		//profiled sizes rounded up to the item sizes that keep the default alignment, the peaks of the sizes sharing a rounded size add up:
+		//the smallest items (which can't hold anything more aligned) are pointer sized, larger ones are multiples of alignof(std::max_align_t)
+		constexpr int64_t MinItemSize = sizeof(void*);
+		constexpr int64_t SizeStep = alignof(std::max_align_t);
+
+		std::vector<int64_t> sizes;
+		std::vector<int64_t> peaks;
+
+		for (auto& sizeRequests : profile.GetSizeRequests())
+		{
+			if (sizeRequests.m_Size > maxItemSize || sizeRequests.m_RequestsTotal == 0)
+			{
+				continue;
+			}
+
+			int64_t size = sizeRequests.m_Size <= MinItemSize ? MinItemSize : (sizeRequests.m_Size + SizeStep - 1) / SizeStep * SizeStep;
+			int64_t peak = std::max(sizeRequests.m_RequestsMax, (int64_t)1);
+
+			if (sizes.empty() == false && sizes.back() == size)
+			{
+				peaks.back() += peak;
+			}
+			else
+			{
+				sizes.push_back(size);
+				peaks.push_back(peak);
+			}
+		}
+
+		if (sizes.empty())
+		{
+			spdlog::warn("Memory pool profile: no requests to derive the settings from, using the default ones");
+			return GetDefaultMemoryPoolSettings(isThreadSafe);
+		}
+
+		int sizesCount = (int)sizes.size();
+		bucketsCount = std::min({bucketsCount, sizesCount, MemoryPoolSettings::MaxBucketsCount});
+
+		//a bucket holding sizes [first, last] wastes (sizes[last] - sizes[i]) * peaks[i] bytes for every size i in it
+		std::vector<int64_t> peaksPrefix(sizesCount + 1, 0);
+		std::vector<int64_t> bytesPrefix(sizesCount + 1, 0);
+
+		for (int i = 0; i < sizesCount; i++)
+		{
+			peaksPrefix[i + 1] = peaksPrefix[i] + peaks[i];
+			bytesPrefix[i + 1] = bytesPrefix[i] + peaks[i] * sizes[i];
+		}
+
+		auto getWastedBytes = [&](int first, int last)
+		{
+			return sizes[last] * (peaksPrefix[last + 1] - peaksPrefix[first]) - (bytesPrefix[last + 1] - bytesPrefix[first]);
+		};
+
+		//wasted[j]: the least waste of the sizes [0, j] in the buckets placed so far, the last bucket ending at j
+		//firstSizes[bucket][j]: the first size of that last bucket. O(bucketsCount * sizesCount^2), sizes are limited by maxItemSize / SizeStep
+		constexpr int64_t Unreachable = std::numeric_limits<int64_t>::max();
+
+		std::vector<int64_t> wasted(sizesCount);
+		std::vector<int64_t> nextWasted(sizesCount);
+		std::vector<std::vector<int>> firstSizes(bucketsCount, std::vector<int>(sizesCount, 0));
+
+		for (int j = 0; j < sizesCount; j++)
+		{
+			wasted[j] = getWastedBytes(0, j);
+		}
+
+		for (int bucket = 1; bucket < bucketsCount; bucket++)
+		{
+			for (int j = 0; j < sizesCount; j++)
+			{
+				nextWasted[j] = Unreachable;
+
+				for (int first = std::max(bucket, 1); first <= j; first++)
+				{
+					if (wasted[first - 1] == Unreachable)
+					{
+						continue;
+					}
+
+					int64_t candidate = wasted[first - 1] + getWastedBytes(first, j);
+
+					if (candidate < nextWasted[j])
+					{
+						nextWasted[j] = candidate;
+						firstSizes[bucket][j] = first;
+					}
+				}
+			}
+
+			std::swap(wasted, nextWasted);
+		}
+
+		//buckets are walked back from the largest size
+		std::vector<int> lastSizes(bucketsCount);
+		int last = sizesCount - 1;
+
+		for (int bucket = bucketsCount - 1; bucket >= 0; bucket--)
+		{
+			lastSizes[bucket] = last;
+			last = firstSizes[bucket][last] - 1;
+		}
+
+		assert(last == -1);
+
+		MemoryPoolSettings settings;
+		int first = 0;
+
+		for (int bucket = 0; bucket < bucketsCount; bucket++)
+		{
+			//the sum of the size peaks is an upper bound of the bucket peak, the sizes may peak at different times
+			int64_t peak = peaksPrefix[lastSizes[bucket] + 1] - peaksPrefix[first];
+			int firstPageItemsCount = (int)std::min(peak, (int64_t)std::numeric_limits<int>::max() / 2);
+
+			settings.AddBucketDefinition((int)sizes[lastSizes[bucket]], firstPageItemsCount, std::max(firstPageItemsCount / 4, 1), true);
+
+			first = lastSizes[bucket] + 1;
+		}
+
+		spdlog::info("Memory pool profile: {} buckets derived from {} sizes, {} bytes wasted at the peaks", bucketsCount, sizesCount, wasted[sizesCount - 1]);
+
+		//thread caches, as in the default settings
+		if (isThreadSafe)
+		{
+			settings.SetThreadCacheSize(64, 1024 * 32);
+		}
+
+		return settings;
+	}
+
+}
@@ -0,0 +1,53 @@
+//
+// Created by Alexander on 26.10.2021.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "memory_pool_settings.h"
+
+namespace st::memory
+{
+	//-----
+	//requests histogram of a pool run: requests total and peak (max live) count per requested size
+	//collected by MEMORY_POOL_PROFILING pools, saved after a representative run and turned into settings for the next ones
+	//-----
+	class MemoryPoolProfile final
+	{
+	public:
+
+		struct SizeRequests
+		{
+			int32_t m_Size;
+			int64_t m_RequestsTotal;
+			int64_t m_RequestsMax;
+		};
+
+		//requests of a size that is already in the profile are merged: totals are summed, the larger peak is kept
+		void AddSizeRequests(int32_t size, int64_t requestsTotal, int64_t requestsMax);
+
+		//sorted by size
+		[[nodiscard]] const std::vector<SizeRequests>& GetSizeRequests() const;
+		[[nodiscard]] bool IsEmpty() const;
+
+		//text format: a "size total max" line per size, lines starting with # are comments
+		//loading merges the file into the profile, so several runs can be combined. false on file or format errors
+		bool SaveToFile(const std::string& filePath) const;
+		bool LoadFromFile(const std::string& filePath);
+
+	private:
+
+		std::vector<SizeRequests> m_SizeRequests;
+	};
+
+
+	//size classes that minimize the internal fragmentation at the profiled peaks: bucketsCount buckets are placed on the profiled sizes
+	//(rounded up to multiples of alignof(std::max_align_t), so size-only requests stay aligned) so that the bytes wasted by the live items at their peaks are the smallest.
+	//first pages hold the peak items count of their sizes and are pre-warmed. Sizes above maxItemSize are left to the heap,
+	//like the sizes the profile has never seen above its largest one. An empty profile gives the default settings
+	MemoryPoolSettings GetProfileGuidedMemoryPoolSettings(const MemoryPoolProfile& profile, bool isThreadSafe, int bucketsCount = DefaultSizeClassesCount, int maxItemSize = DefaultSizeClasses[DefaultSizeClassesCount - 1].m_ItemSize);
+
+}
@@ -3,13 +3,23 @@
 //
 
 #include <cstring>
+#include <algorithm>
 #include "spdlog/spdlog.h"
 #include "memory_pool_settings.h"
 
 
 namespace st::memory
 {
-	MemoryPoolSettings::MemoryPoolSettings() : m_BucketsCount(0)
+	MemoryPoolSettings::MemoryPoolSettings() :
+			m_BucketsCount(0),
+			m_SyncMode(MemoryPoolSyncMode::Mutex),
+			m_ThreadCacheItemsCount(0),
+			m_ThreadCacheBytesPerBucket(0),
+			m_RetainedEmptyPagesCount(RetainAllEmptyPages),
+			m_MaxExtraPageSize(DefaultMaxExtraPageSize),
+			m_BackgroundProvisioning(false),
+			m_CpuShardsCount(0),
+			m_LeakTrackingSampleInterval(DefaultLeakTrackingSampleInterval)
 	{
 		std::memset(m_BucketDefinitions, 0, sizeof(BucketDefinition) * MaxBucketsCount);
 	}
@@ -30,7 +40,13 @@ namespace st::memory
 	}
 
 
-	void MemoryPoolSettings::AddBucketDefinition(int itemSize, int firstPageItemsCount, int extraPageItemsCount, bool preWarmFirstPage)
+	void MemoryPoolSettings::AddBucketDefinition(int itemSize, int firstPageItemsCount, int extraPageItemsCount, bool preWarmFirstPage, MemoryPoolPageBacking pageBacking)
+	{
+		AddBucketDefinition(BucketDefinition(itemSize, firstPageItemsCount, extraPageItemsCount, preWarmFirstPage, pageBacking));
+	}
+
+
+	void MemoryPoolSettings::AddBucketDefinition(const BucketDefinition& bucketDefinition)
 	{
 		if (m_BucketsCount == MaxBucketsCount)
 		{
@@ -40,7 +56,141 @@ namespace st::memory
 
 		m_BucketsCount++;
 
-		m_BucketDefinitions[m_BucketsCount - 1] = BucketDefinition(itemSize, firstPageItemsCount, extraPageItemsCount, preWarmFirstPage);
+		m_BucketDefinitions[m_BucketsCount - 1] = bucketDefinition;
+	}
+
+
+	bool MemoryPoolSettings::UsesDefaultSizeClasses() const
+	{
+		if (m_BucketsCount != DefaultSizeClassesCount)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < m_BucketsCount; i++)
+		{
+			//items smaller than a pointer are rounded up by the bucket
+			if (std::max(m_BucketDefinitions[i].m_ItemSize, (int)sizeof(void*)) != DefaultSizeClasses[i].m_ItemSize)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	void MemoryPoolSettings::SetThreadCacheSize(int itemsCount, int bytesPerBucket)
+	{
+		assert(itemsCount >= 0);
+		assert(bytesPerBucket >= 0);
+
+		m_ThreadCacheItemsCount = itemsCount;
+		m_ThreadCacheBytesPerBucket = bytesPerBucket;
+	}
+
+
+	int MemoryPoolSettings::GetThreadCacheItemsCount() const
+	{
+		return m_ThreadCacheItemsCount;
+	}
+
+
+	int MemoryPoolSettings::GetThreadCacheBytesPerBucket() const
+	{
+		return m_ThreadCacheBytesPerBucket;
+	}
+
+
+	int MemoryPoolSettings::GetThreadCacheCapacity(int bucketIndex) const
+	{
+		if (m_ThreadCacheItemsCount == 0)
+		{
+			return 0;
+		}
+
+		int itemSize = GetBucketDefinition(bucketIndex).m_ItemSize;
+
+		//at least 2 items so that a flush always leaves something in the cache
+		return std::clamp(m_ThreadCacheBytesPerBucket / itemSize, 2, std::max(2, m_ThreadCacheItemsCount));
+	}
+
+
+	void MemoryPoolSettings::SetSyncMode(MemoryPoolSyncMode syncMode)
+	{
+		m_SyncMode = syncMode;
+	}
+
+
+	MemoryPoolSyncMode MemoryPoolSettings::GetSyncMode() const
+	{
+		return m_SyncMode;
+	}
+
+
+	void MemoryPoolSettings::SetRetainedEmptyPagesCount(int retainedEmptyPagesCount)
+	{
+		assert(retainedEmptyPagesCount >= 0 || retainedEmptyPagesCount == RetainAllEmptyPages);
+
+		m_RetainedEmptyPagesCount = retainedEmptyPagesCount;
+	}
+
+
+	int MemoryPoolSettings::GetRetainedEmptyPagesCount() const
+	{
+		return m_RetainedEmptyPagesCount;
+	}
+
+
+	void MemoryPoolSettings::SetMaxExtraPageSize(size_t maxExtraPageSize)
+	{
+		m_MaxExtraPageSize = maxExtraPageSize;
+	}
+
+
+	size_t MemoryPoolSettings::GetMaxExtraPageSize() const
+	{
+		return m_MaxExtraPageSize;
+	}
+
+
+	void MemoryPoolSettings::SetBackgroundProvisioning(bool enabled)
+	{
+		m_BackgroundProvisioning = enabled;
+	}
+
+
+	bool MemoryPoolSettings::IsBackgroundProvisioningEnabled() const
+	{
+		return m_BackgroundProvisioning;
+	}
+
+
+	void MemoryPoolSettings::SetCpuShardsCount(int cpuShardsCount)
+	{
+		assert(cpuShardsCount >= 0);
+
+		m_CpuShardsCount = cpuShardsCount;
+	}
+
+
+	int MemoryPoolSettings::GetCpuShardsCount() const
+	{
+		return m_CpuShardsCount;
+	}
+
+
+	void MemoryPoolSettings::SetLeakTrackingSampleInterval(int sampleInterval)
+	{
+		assert(sampleInterval > 0);
+
+		m_LeakTrackingSampleInterval = sampleInterval;
+	}
+
+
+	int MemoryPoolSettings::GetLeakTrackingSampleInterval() const
+	{
+		return m_LeakTrackingSampleInterval;
 	}
 
 
@@ -48,31 +198,18 @@ namespace st::memory
 	{
 		MemoryPoolSettings settings;
 
-		bool conditionalPrewarm = !isThreadSafe;
-
-		//small sizes
-		settings.AddBucketDefinition(4, 1024 * 8, 1024, true);
-		settings.AddBucketDefinition(8, 1024 * 8, 1024, true);
-		settings.AddBucketDefinition(16, 1024 * 8, 1024, true);
-		settings.AddBucketDefinition(32, 1024 * 8, 1024, true);
-		settings.AddBucketDefinition(64, 1024 * 8, 1024, true);
-		settings.AddBucketDefinition(128, 1024 * 8, 1024, true);
-
-		//medium sizes
-		settings.AddBucketDefinition(128 + 64, 1024 * 4, 1024, true);
-		settings.AddBucketDefinition(256, 1024 * 4, 1024, true);
-		settings.AddBucketDefinition(256 + 128, 1024 * 4, 1024, true);
-		settings.AddBucketDefinition(512, 1024, 512, conditionalPrewarm);
-
-		//large sizes
-		settings.AddBucketDefinition(512 + 256, 1024, 256, conditionalPrewarm);
-		settings.AddBucketDefinition(1024, 128, 64, conditionalPrewarm);
-		settings.AddBucketDefinition(2048, 64, 32, conditionalPrewarm);
-		settings.AddBucketDefinition(1024 * 4, 32, 16, conditionalPrewarm);
-		settings.AddBucketDefinition(1024 * 6, 16, 8, conditionalPrewarm);
-		settings.AddBucketDefinition(1024 * 8, 16, 8, false);
-		settings.AddBucketDefinition(1024 * 12, 16, 8, false);
-		settings.AddBucketDefinition(1024 * 16, 8, 4, false);
+		for (auto& sizeClass : DefaultSizeClasses)
+		{
+			bool preWarm = sizeClass.m_PreWarm == MemoryPoolPreWarm::Always || (sizeClass.m_PreWarm == MemoryPoolPreWarm::SingleThreadedOnly && !isThreadSafe);
+
+			settings.AddBucketDefinition(sizeClass.m_ItemSize, sizeClass.m_FirstPageItemsCount, sizeClass.m_ExtraPageItemsCount, preWarm);
+		}
+
+		//thread caches
+		if (isThreadSafe)
+		{
+			settings.SetThreadCacheSize(64, 1024 * 32);
+		}
 
 		return settings;
 	}
@@ -5,30 +5,68 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <iterator>
 
 namespace st::memory
 {
+	//synchronization of the thread safe pool buckets
+	enum class MemoryPoolSyncMode
+	{
+		Mutex,		//buckets are guarded by the pool mutex
+		LockFree,	//buckets are lock-free stacks, allocations and deallocations never wait for another thread
+		ThreadOwned,	//every thread allocates from its own heap, frees from other threads go to the owner's remote free lists
+		PerCpu		//buckets are sharded by the current cpu, each shard has its own mutex. Frees from other cpus go to the shard's remote free lists
+	};
+
+
+	//-----
+	//item alignment: bucket items are aligned by the highest power of two their size is a multiple of,
+	//slabs place their first item accordingly. Alignments above MaxItemAlignment are served by the heap
+	//-----
+	inline constexpr int MemoryPoolMaxItemAlignment = 4096;
+
+	constexpr int GetPoolItemAlignment(int itemSize)
+	{
+		int alignment = itemSize & -itemSize;
+
+		return alignment < MemoryPoolMaxItemAlignment ? alignment : MemoryPoolMaxItemAlignment;
+	}
+
+
+	//where bucket pages come from
+	enum class MemoryPoolPageBacking
+	{
+		Heap,		//aligned heap allocations
+		Mmap,		//anonymous mappings: slab aligned, committed lazily, unmapped on release (heap on platforms without mmap)
+		HugePages	//pages are rounded up to whole huge pages: explicit huge pages if the system has them reserved, transparent ones otherwise
+	};
+
 
 	class MemoryPoolSettings final
 	{
 	public:
 
 		static constexpr int MaxBucketsCount = 256;
+		static constexpr int RetainAllEmptyPages = -1;
+		static constexpr size_t DefaultMaxExtraPageSize = 4 * 1024 * 1024;
+		static constexpr int DefaultLeakTrackingSampleInterval = 64;
 
 		struct BucketDefinition
 		{
 		public:
 
-			BucketDefinition() : m_ItemSize(0), m_FirstPageItemsCount(0), m_ExtraPageItemsCount(0), m_PreWarmFirstPage(false)
+			BucketDefinition() : m_ItemSize(0), m_FirstPageItemsCount(0), m_ExtraPageItemsCount(0), m_PreWarmFirstPage(false), m_PageBacking(MemoryPoolPageBacking::Mmap)
 			{
 
 			}
 
-			BucketDefinition(int itemSize, int firstPageItemsCount, int pageItemsCount, bool preWarmFirstPage = true) :
+			BucketDefinition(int itemSize, int firstPageItemsCount, int pageItemsCount, bool preWarmFirstPage = true, MemoryPoolPageBacking pageBacking = MemoryPoolPageBacking::Mmap) :
 					m_ItemSize(itemSize),
 					m_FirstPageItemsCount(firstPageItemsCount),
 					m_ExtraPageItemsCount(pageItemsCount),
-					m_PreWarmFirstPage(preWarmFirstPage)
+					m_PreWarmFirstPage(preWarmFirstPage),
+					m_PageBacking(pageBacking)
 			{
 				assert(m_ItemSize > 0);
 				assert(m_FirstPageItemsCount > 0);
@@ -40,6 +78,7 @@ namespace st::memory
 			int m_FirstPageItemsCount;
 			int m_ExtraPageItemsCount;
 			bool m_PreWarmFirstPage;
+			MemoryPoolPageBacking m_PageBacking;
 		};
 
 		MemoryPoolSettings();
@@ -47,16 +86,131 @@ namespace st::memory
 		[[nodiscard]] int GetBucketsCount() const;
 		[[nodiscard]] const BucketDefinition& GetBucketDefinition(int index) const;
 
-		void AddBucketDefinition(int itemSize, int firstPageItemsCount, int extraPageItemsCount, bool preWarmFirstPage);
+		void AddBucketDefinition(int itemSize, int firstPageItemsCount, int extraPageItemsCount, bool preWarmFirstPage, MemoryPoolPageBacking pageBacking = MemoryPoolPageBacking::Mmap);
+		void AddBucketDefinition(const BucketDefinition& bucketDefinition);
+
+		//true if the bucket item sizes match DefaultSizeClasses, so the compile time bucket lookup is valid
+		[[nodiscard]] bool UsesDefaultSizeClasses() const;
+
+		//thread caches (thread safe pool only): itemsCount == 0 disables them
+		//the per bucket cache capacity is limited by both the items count and the bytes amount
+		void SetThreadCacheSize(int itemsCount, int bytesPerBucket);
+		[[nodiscard]] int GetThreadCacheItemsCount() const;
+		[[nodiscard]] int GetThreadCacheBytesPerBucket() const;
+		[[nodiscard]] int GetThreadCacheCapacity(int bucketIndex) const;
+
+		//thread safe pool only
+		void SetSyncMode(MemoryPoolSyncMode syncMode);
+		[[nodiscard]] MemoryPoolSyncMode GetSyncMode() const;
+
+		//empty extra pages kept by every bucket, the ones above this count are freed as soon as they get empty
+		//RetainAllEmptyPages (the default) keeps them until Trim or Release. Lock-free buckets always keep them
+		void SetRetainedEmptyPagesCount(int retainedEmptyPagesCount);
+		[[nodiscard]] int GetRetainedEmptyPagesCount() const;
+
+		//extra pages grow geometrically: every extra page a bucket has doubles the size of the next one, up to maxExtraPageSize bytes
+		//pages freed by the bucket shrink the next one back. 0 keeps extra pages at their bucket definition size
+		void SetMaxExtraPageSize(size_t maxExtraPageSize);
+		[[nodiscard]] size_t GetMaxExtraPageSize() const;
+
+		//thread safe pool in the mutex mode only: a background thread adds pages to the buckets running low on free items
+		//(below a half of their next extra page), so allocations don't wait for page creation
+		void SetBackgroundProvisioning(bool enabled);
+		[[nodiscard]] bool IsBackgroundProvisioningEnabled() const;
+
+		//per cpu mode only: 0 (the default) creates a shard per hardware thread
+		void SetCpuShardsCount(int cpuShardsCount);
+		[[nodiscard]] int GetCpuShardsCount() const;
+
+		//leak tracking mode (MEMORY_POOL_LEAK_TRACKING) only: the call stack of every sampleInterval-th allocation of a thread is captured
+		void SetLeakTrackingSampleInterval(int sampleInterval);
+		[[nodiscard]] int GetLeakTrackingSampleInterval() const;
 
 	private:
 
 		int m_BucketsCount;
 
+		MemoryPoolSyncMode m_SyncMode;
+
+		int m_ThreadCacheItemsCount;
+		int m_ThreadCacheBytesPerBucket;
+
+		int m_RetainedEmptyPagesCount;
+
+		size_t m_MaxExtraPageSize;
+		bool m_BackgroundProvisioning;
+
+		int m_CpuShardsCount;
+
+		int m_LeakTrackingSampleInterval;
+
 		BucketDefinition m_BucketDefinitions[MaxBucketsCount];
 
 	};
 
 	MemoryPoolSettings GetDefaultMemoryPoolSettings(bool isThreadSafe);
 
+
+	//-----
+	//default size classes
+	//they are known at compile time, so typed allocations from a pool that uses them resolve their bucket statically
+	//-----
+	enum class MemoryPoolPreWarm
+	{
+		Always,
+		SingleThreadedOnly,
+		Never
+	};
+
+	struct MemoryPoolSizeClass
+	{
+		int m_ItemSize;
+		int m_FirstPageItemsCount;
+		int m_ExtraPageItemsCount;
+		MemoryPoolPreWarm m_PreWarm;
+	};
+
+	inline constexpr MemoryPoolSizeClass DefaultSizeClasses[] =
+	{
+		//small sizes (the smallest item is pointer sized: free items hold the free list link)
+		{8, 1024 * 8, 1024, MemoryPoolPreWarm::Always},
+		{16, 1024 * 8, 1024, MemoryPoolPreWarm::Always},
+		{32, 1024 * 8, 1024, MemoryPoolPreWarm::Always},
+		{64, 1024 * 8, 1024, MemoryPoolPreWarm::Always},
+		{128, 1024 * 8, 1024, MemoryPoolPreWarm::Always},
+
+		//medium sizes
+		{128 + 64, 1024 * 4, 1024, MemoryPoolPreWarm::Always},
+		{256, 1024 * 4, 1024, MemoryPoolPreWarm::Always},
+		{256 + 128, 1024 * 4, 1024, MemoryPoolPreWarm::Always},
+		{512, 1024, 512, MemoryPoolPreWarm::SingleThreadedOnly},
+
+		//large sizes
+		{512 + 256, 1024, 256, MemoryPoolPreWarm::SingleThreadedOnly},
+		{1024, 128, 64, MemoryPoolPreWarm::SingleThreadedOnly},
+		{2048, 64, 32, MemoryPoolPreWarm::SingleThreadedOnly},
+		{1024 * 4, 32, 16, MemoryPoolPreWarm::SingleThreadedOnly},
+		{1024 * 6, 16, 8, MemoryPoolPreWarm::SingleThreadedOnly},
+		{1024 * 8, 16, 8, MemoryPoolPreWarm::Never},
+		{1024 * 12, 16, 8, MemoryPoolPreWarm::Never},
+		{1024 * 16, 8, 4, MemoryPoolPreWarm::Never}
+	};
+
+	inline constexpr int DefaultSizeClassesCount = (int)std::size(DefaultSizeClasses);
+
+	//the smallest size class that fits the size and is aligned enough
+	//-1 if the size doesn't fit into the default size classes
+	constexpr int GetDefaultSizeClassIndex(size_t size, size_t alignment = alignof(void*))
+	{
+		for (int i = 0; i < DefaultSizeClassesCount; i++)
+		{
+			if (size <= (size_t)DefaultSizeClasses[i].m_ItemSize && alignment <= (size_t)GetPoolItemAlignment(DefaultSizeClasses[i].m_ItemSize))
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+//
+// Created by Alexander on 28.10.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include "memory_pool_bucket.h"
+#include "utils_bits.h"
+
+namespace st::memory
+{
+	//-----
+	//size to bucket lookup, shared by the static pools and the pool instances
+	//small sizes are looked up in 8 bytes steps: (size + 7) >> 3
+	//larger sizes in quarter steps of powers of two, the found bucket is the smallest one that may fit the whole step
+	//buckets are expected to be sorted by item size, they are kept by the owner
+	//-----
+	class MemoryPoolSizeLookup final
+	{
+	public:
+
+		static constexpr int InvalidIndex = -1;
+
+		void Build(const MemoryPoolBucket* pBuckets, int bucketsCount)
+		{
+			assert(bucketsCount > 0);
+
+			m_pBuckets = pBuckets;
+			m_BucketsCount = bucketsCount;
+
+			m_MaxItemSize = m_pBuckets[m_BucketsCount - 1].GetItemSize();
+			m_MinItemAlignment = MemoryPoolMaxItemAlignment;
+
+			for (int i = 0; i < m_BucketsCount; i++)
+			{
+				m_MinItemAlignment = std::min(m_MinItemAlignment, (size_t)m_pBuckets[i].GetAlignment());
+			}
+
+			auto findBucket = [this](size_t minItemSize) -> int16_t
+			{
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					if ((size_t)m_pBuckets[i].GetItemSize() >= std::min(minItemSize, m_MaxItemSize))
+					{
+						return (int16_t)i;
+					}
+				}
+
+				return InvalidIndex;
+			};
+
+			for (int i = 0; i < SmallSizeLookupCount; i++)
+			{
+				m_SmallSizeLookup[i] = findBucket((size_t)i << 3);
+			}
+
+			for (int i = 0; i < LargeSizeLookupCount; i++)
+			{
+				int bit = LargeSizeFirstBit + i / LargeSizeStepsPerBit;
+				int step = i % LargeSizeStepsPerBit;
+
+				if (bit >= 62)
+				{
+					m_LargeSizeLookup[i] = InvalidIndex;
+					continue;
+				}
+
+				size_t stepMinSize = ((size_t)(LargeSizeStepsPerBit + step) << (bit - 2)) + 1;
+				m_LargeSizeLookup[i] = findBucket(stepMinSize);
+			}
+		}
+
+		[[nodiscard]] inline int GetBucketIndex(size_t size) const
+		{
+			if (size > m_MaxItemSize)
+			{
+				return InvalidIndex;
+			}
+
+			if (size <= SmallSizeMax)
+			{
+				return m_SmallSizeLookup[(size + 7) >> 3];
+			}
+
+			//a bucket inside of the step may be too small for this exact size
+			int bucketIndex = m_LargeSizeLookup[GetLargeSizeLookupIndex(size)];
+
+			assert(bucketIndex != InvalidIndex);
+
+			while ((size_t)m_pBuckets[bucketIndex].GetItemSize() < size)
+			{
+				bucketIndex++;
+			}
+
+			assert(bucketIndex < m_BucketsCount);
+
+			return bucketIndex;
+		}
+
+		//over-aligned requests skip the buckets that fit the size, but are not aligned enough
+		[[nodiscard]] inline int GetBucketIndex(size_t size, size_t alignment) const
+		{
+			assert((alignment & (alignment - 1)) == 0);
+
+			int bucketIndex = GetBucketIndex(size);
+
+			if (alignment <= m_MinItemAlignment || bucketIndex == InvalidIndex)
+			{
+				return bucketIndex;
+			}
+
+			while ((size_t)m_pBuckets[bucketIndex].GetAlignment() < alignment)
+			{
+				bucketIndex++;
+
+				if (bucketIndex == m_BucketsCount)
+				{
+					return InvalidIndex;
+				}
+			}
+
+			return bucketIndex;
+		}
+
+	private:
+
+		static constexpr size_t SmallSizeMax = 1024;
+		static constexpr int SmallSizeLookupCount = (SmallSizeMax >> 3) + 1;
+		static constexpr int LargeSizeFirstBit = 10; //GetHighestBitIndex(SmallSizeMax)
+		static constexpr int LargeSizeStepsPerBit = 4;
+		static constexpr int LargeSizeLookupCount = (64 - LargeSizeFirstBit) * LargeSizeStepsPerBit;
+
+		static inline int GetLargeSizeLookupIndex(size_t size)
+		{
+			assert(size > SmallSizeMax);
+
+			int bit = st::utils::GetHighestBitIndex(size - 1);
+			int step = (int)((size - 1) >> (bit - 2)) & (LargeSizeStepsPerBit - 1);
+
+			return (bit - LargeSizeFirstBit) * LargeSizeStepsPerBit + step;
+		}
+
+		const MemoryPoolBucket* m_pBuckets = nullptr;
+		int m_BucketsCount = 0;
+
+		size_t m_MaxItemSize = 0;
+		size_t m_MinItemAlignment = 0;
+		int16_t m_SmallSizeLookup[SmallSizeLookupCount];
+		int16_t m_LargeSizeLookup[LargeSizeLookupCount];
+	};
+}
@@ -0,0 +1,255 @@
+//
+// Created by Alexander on 19.10.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include "memory_settings.h"
+#include "memory_pool_settings.h"
+
+namespace st::memory
+{
+	class MemoryPoolBucket;
+
+	//-----
+	//bucket pages consist of one or more slabs
+	//every slab is SlabSize aligned and starts with this header, followed by the items
+	//so the slab of any pooled pointer is found by masking the pointer
+	//the first item is placed at the item alignment (GetPoolItemAlignment), at least right after the header
+	//-----
+	struct alignas(64) MemoryPoolSlab final
+	{
+		static constexpr size_t SlabSize = 256 * 1024;
+
+		static inline MemoryPoolSlab* FromPointer(void* p)
+		{
+			return reinterpret_cast<MemoryPoolSlab*>(reinterpret_cast<uintptr_t>(p) & ~(uintptr_t)(SlabSize - 1));
+		}
+
+#if defined(MEMORY_POOL_CHECKED) || defined(MEMORY_POOL_LEAK_TRACKING)
+		//the debug modes keep bytes per item between the header and the items:
+		//the checked mode a state (see MemoryPoolChecks), the leak tracking a sampled flag (see MemoryPool::OnAllocated)
+#if defined(MEMORY_POOL_CHECKED) && defined(MEMORY_POOL_LEAK_TRACKING)
+		static constexpr int ItemMetadataSize = 2;
+#else
+		static constexpr int ItemMetadataSize = 1;
+#endif
+
+		static constexpr int GetItemMetadataCount(int itemSize)
+		{
+			return (int)((SlabSize - sizeof(MemoryPoolSlab)) / (itemSize + ItemMetadataSize));
+		}
+
+		static constexpr size_t GetItemsOffset(int itemSize)
+		{
+			auto alignment = (size_t)GetPoolItemAlignment(itemSize);
+			auto headerSize = sizeof(MemoryPoolSlab) + (size_t)GetItemMetadataCount(itemSize) * ItemMetadataSize;
+
+			return (headerSize + alignment - 1) & ~(alignment - 1);
+		}
+
+		static constexpr int GetItemsCapacity(int itemSize)
+		{
+			auto capacity = (int)((SlabSize - GetItemsOffset(itemSize)) / itemSize);
+
+			return capacity < GetItemMetadataCount(itemSize) ? capacity : GetItemMetadataCount(itemSize);
+		}
+
+		[[nodiscard]] inline int GetItemIndex(void* p)
+		{
+			return (int)((static_cast<char*>(p) - GetItemsStart()) / m_ItemSize);
+		}
+#else
+		static constexpr size_t GetItemsOffset(int itemSize)
+		{
+			auto alignment = (size_t)GetPoolItemAlignment(itemSize);
+
+			return alignment > sizeof(MemoryPoolSlab) ? alignment : sizeof(MemoryPoolSlab);
+		}
+
+		static constexpr int GetItemsCapacity(int itemSize)
+		{
+			return (int)((SlabSize - GetItemsOffset(itemSize)) / itemSize);
+		}
+#endif
+
+#ifdef MEMORY_POOL_CHECKED
+		[[nodiscard]] inline uint8_t* GetItemStates()
+		{
+			return reinterpret_cast<uint8_t*>(this) + sizeof(MemoryPoolSlab);
+		}
+#endif
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+		[[nodiscard]] inline uint8_t* GetItemSampledFlags()
+		{
+			return reinterpret_cast<uint8_t*>(this) + sizeof(MemoryPoolSlab) + (ItemMetadataSize - 1) * GetItemMetadataCount(m_ItemSize);
+		}
+#endif
+
+		void Setup(MemoryPoolBucket* pBucket, MemoryPoolSlab* pPage, int itemSize)
+		{
+			m_ItemSize = itemSize;
+			m_ItemsCount = GetItemsCapacity(itemSize);
+			m_FreeItemsCount = m_ItemsCount;
+
+			m_pBucket = pBucket;
+			m_pPage = pPage;
+			m_pNextPage = nullptr;
+			m_PageSlabsCount = 0;
+			m_PageEmptySlabsCount = 0;
+			m_IsExtraPage = false;
+
+			m_pNextAvailable = nullptr;
+			m_pPrevAvailable = nullptr;
+
+			m_pFreeList = nullptr;
+			m_pUncarved = GetItemsStart();
+
+			m_pEnd = m_pUncarved + m_ItemsCount * itemSize;
+
+#ifdef MEMORY_POOL_CHECKED
+			std::memset(GetItemStates(), 0, m_ItemsCount);
+#endif
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			std::memset(GetItemSampledFlags(), 0, m_ItemsCount);
+#endif
+		}
+
+		//free items are handed out LIFO, then the never used part of the slab is carved in address order
+		[[nodiscard]] inline void* Allocate()
+		{
+			assert(m_FreeItemsCount > 0);
+
+			m_FreeItemsCount--;
+
+			if (m_pFreeList != nullptr)
+			{
+				void* pResult = m_pFreeList;
+				m_pFreeList = *static_cast<void**>(pResult);
+				return pResult;
+			}
+
+			assert(m_pUncarved < m_pEnd);
+
+			void* pResult = m_pUncarved;
+			m_pUncarved += m_ItemSize;
+			return pResult;
+		}
+
+		//takes up to count items at once: a segment of the free list first, then a run of never used items
+		//returns the amount of items taken
+		[[nodiscard]] inline int AllocateBatch(void** pOut, int count)
+		{
+			int takenCount = count < m_FreeItemsCount ? count : m_FreeItemsCount;
+			int i = 0;
+
+			for (; i < takenCount && m_pFreeList != nullptr; i++)
+			{
+				pOut[i] = m_pFreeList;
+				m_pFreeList = *static_cast<void**>(m_pFreeList);
+			}
+
+			for (; i < takenCount; i++)
+			{
+				assert(m_pUncarved < m_pEnd);
+
+				pOut[i] = m_pUncarved;
+				m_pUncarved += m_ItemSize;
+			}
+
+			m_FreeItemsCount -= takenCount;
+
+			return takenCount;
+		}
+
+		inline void Deallocate(void* p)
+		{
+			assert(m_FreeItemsCount < m_ItemsCount);
+
+			*static_cast<void**>(p) = m_pFreeList;
+			m_pFreeList = p;
+
+			m_FreeItemsCount++;
+		}
+
+		[[nodiscard]] inline bool IsFull() const {return m_FreeItemsCount == 0;}
+		[[nodiscard]] inline bool IsEmpty() const {return m_FreeItemsCount == m_ItemsCount;}
+		[[nodiscard]] inline bool IsPageEmpty() const {return m_PageEmptySlabsCount == m_PageSlabsCount;}
+
+		[[nodiscard]] inline char* GetItemsStart()
+		{
+			return reinterpret_cast<char*>(this) + GetItemsOffset(m_ItemSize);
+		}
+
+		//an empty slab forgets its items, they are carved again on demand
+		//so the items memory can be handed back to the system without breaking the free list
+		void ResetItems()
+		{
+			assert(IsEmpty());
+
+			m_pFreeList = nullptr;
+			m_pUncarved = GetItemsStart();
+
+#ifdef MEMORY_POOL_CHECKED
+			std::memset(GetItemStates(), 0, m_ItemsCount);
+#endif
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			std::memset(GetItemSampledFlags(), 0, m_ItemsCount);
+#endif
+		}
+
+		[[nodiscard]] inline bool ContainsItem(void* p) const
+		{
+			auto pItems = reinterpret_cast<const char*>(this) + GetItemsOffset(m_ItemSize);
+			auto pItem = static_cast<const char*>(p);
+
+			return pItem >= pItems && pItem < m_pUncarved && (pItem - pItems) % m_ItemSize == 0;
+		}
+
+		[[nodiscard]] bool IsInFreeList(void* p) const
+		{
+			for (void* pItem = m_pFreeList; pItem != nullptr; pItem = *static_cast<void**>(pItem))
+			{
+				if (pItem == p)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		MemoryPoolBucket* m_pBucket;
+
+		//page data: the first slab of a page holds the page list link, the slabs count and the empty slabs count
+		//the page is empty (no live items) when all of its slabs are empty
+		MemoryPoolSlab* m_pPage;
+		MemoryPoolSlab* m_pNextPage;
+		int m_PageSlabsCount;
+		int m_PageEmptySlabsCount;
+		bool m_IsExtraPage;
+
+		//slabs with free items, allocation takes from the first one
+		MemoryPoolSlab* m_pNextAvailable;
+		MemoryPoolSlab* m_pPrevAvailable;
+
+		//free items store the next free item pointer in place
+		void* m_pFreeList;
+		char* m_pUncarved;
+		char* m_pEnd;
+
+		int m_ItemSize;
+		int m_ItemsCount;
+		int m_FreeItemsCount;
+	};
+
+	static_assert((MemoryPoolSlab::SlabSize & (MemoryPoolSlab::SlabSize - 1)) == 0);
+	static_assert(sizeof(MemoryPoolSlab) % alignof(std::max_align_t) == 0);
+}
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "memory_pool.h"
+#include "memory_pool_instance.h"
+#include "memory_arena.h"
 
 namespace st::memory
 {
@@ -21,7 +23,7 @@ namespace st::memory
 		{
 			std::size_t size = n * sizeof(T);
 
-			void* pResult = MemoryPoolSingleThreaded::Allocate(size);
+			void* pResult = MemoryPoolSingleThreaded::Allocate(size, alignof(T));
 
 			return reinterpret_cast<T*>(pResult);
 		}
@@ -30,7 +32,7 @@ namespace st::memory
 		{
 			std::size_t size = n * sizeof(T);
 
-			MemoryPoolSingleThreaded::Deallocate(p, size);
+			MemoryPoolSingleThreaded::Deallocate(p, size, alignof(T));
 		}
 	};
 
@@ -52,7 +54,7 @@ namespace st::memory
 		{
 			std::size_t size = n * sizeof(T);
 
-			void* pResult = MemoryPoolMultiThreaded::Allocate(size);
+			void* pResult = MemoryPoolMultiThreaded::Allocate(size, alignof(T));
 
 			return reinterpret_cast<T*>(pResult);
 		}
@@ -61,7 +63,7 @@ namespace st::memory
 		{
 			std::size_t size = n * sizeof(T);
 
-			MemoryPoolMultiThreaded::Deallocate(p, size);
+			MemoryPoolMultiThreaded::Deallocate(p, size, alignof(T));
 		}
 	};
 
@@ -69,4 +71,82 @@ namespace st::memory
 	bool operator==(const AllocatorMultiThreaded <T>&, const AllocatorMultiThreaded <U>&) { return true; }
 	template <class T, class U>
 	bool operator!=(const AllocatorMultiThreaded <T>&, const AllocatorMultiThreaded <U>&) { return false; }
+
+
+	//allocates from a pool instance, containers using different instances don't share their memory
+	template<typename T, bool isThreadSafe> class InstanceAllocator
+	{
+	public:
+
+		typedef T value_type;
+
+		//the instance kind is not a type, so the default rebind doesn't apply
+		template <class U> struct rebind
+		{
+			typedef InstanceAllocator<U, isThreadSafe> other;
+		};
+
+		explicit InstanceAllocator(MemoryPoolInstance<isThreadSafe>& instance) noexcept : m_pInstance(&instance) {}
+		template <class U> constexpr explicit InstanceAllocator (const InstanceAllocator <U, isThreadSafe>& other) noexcept : m_pInstance(other.m_pInstance) {}
+
+		[[nodiscard]] T* allocate(std::size_t n)
+		{
+			std::size_t size = n * sizeof(T);
+
+			void* pResult = m_pInstance->Allocate(size, alignof(T));
+
+			return reinterpret_cast<T*>(pResult);
+		}
+
+		void deallocate(T* p, std::size_t n) noexcept
+		{
+			std::size_t size = n * sizeof(T);
+
+			m_pInstance->Deallocate(p, size, alignof(T));
+		}
+
+		MemoryPoolInstance<isThreadSafe>* m_pInstance;
+	};
+
+	template <class T, class U, bool isThreadSafe>
+	bool operator==(const InstanceAllocator <T, isThreadSafe>& a, const InstanceAllocator <U, isThreadSafe>& b) { return a.m_pInstance == b.m_pInstance; }
+	template <class T, class U, bool isThreadSafe>
+	bool operator!=(const InstanceAllocator <T, isThreadSafe>& a, const InstanceAllocator <U, isThreadSafe>& b) { return a.m_pInstance != b.m_pInstance; }
+
+	template<typename T> using InstanceAllocatorSingleThreaded = InstanceAllocator<T, false>;
+	template<typename T> using InstanceAllocatorMultiThreaded = InstanceAllocator<T, true>;
+
+
+	//allocates from an arena: deallocation is a no-op, the memory comes back with the arena reset
+	//containers are expected to be done before the arena is reset
+	template<typename T> class ArenaAllocator
+	{
+	public:
+
+		typedef T value_type;
+
+		explicit ArenaAllocator(MemoryArena& arena) noexcept : m_pArena(&arena) {}
+		template <class U> constexpr explicit ArenaAllocator (const ArenaAllocator <U>& other) noexcept : m_pArena(other.m_pArena) {}
+
+		[[nodiscard]] T* allocate(std::size_t n)
+		{
+			std::size_t size = n * sizeof(T);
+
+			void* pResult = m_pArena->Allocate(size, alignof(T));
+
+			return reinterpret_cast<T*>(pResult);
+		}
+
+		void deallocate(T*, std::size_t) noexcept
+		{
+
+		}
+
+		MemoryArena* m_pArena;
+	};
+
+	template <class T, class U>
+	bool operator==(const ArenaAllocator <T>& a, const ArenaAllocator <U>& b) { return a.m_pArena == b.m_pArena; }
+	template <class T, class U>
+	bool operator!=(const ArenaAllocator <T>& a, const ArenaAllocator <U>& b) { return a.m_pArena != b.m_pArena; }
 }
@@ -0,0 +1,236 @@
+//
+// Created by Alexander on 29.10.2021.
+//
+
+#include <cstdlib>
+#include "memory_arena.h"
+#include "memory_pool.h"
+#include "spdlog/spdlog.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace st::memory
+{
+
+	MemoryArena::MemoryArena(size_t chunkSize, MemoryArenaChunkSource chunkSource) :
+			m_ChunkSize(chunkSize),
+			m_ChunkSource(chunkSource),
+			m_Current(0),
+			m_End(0),
+			m_pUsedChunks(nullptr),
+			m_pOversizedChunks(nullptr),
+			m_pFreeChunks(nullptr),
+			m_UsedSizeBefore(0),
+			m_ReservedSize(0),
+			m_ChunksCount(0)
+	{
+		assert(m_ChunkSize > ChunkHeaderSize);
+	}
+
+
+	MemoryArena::~MemoryArena()
+	{
+		Release();
+	}
+
+
+	void MemoryArena::Reset()
+	{
+		FreeChunks(m_pOversizedChunks);
+		m_pOversizedChunks = nullptr;
+
+		while (m_pUsedChunks != nullptr)
+		{
+			auto pChunk = m_pUsedChunks;
+			m_pUsedChunks = pChunk->m_pNext;
+
+			pChunk->m_pNext = m_pFreeChunks;
+			m_pFreeChunks = pChunk;
+		}
+
+		//the next request takes a retained chunk
+		m_Current = 0;
+		m_End = 0;
+		m_UsedSizeBefore = 0;
+	}
+
+
+	void MemoryArena::Release()
+	{
+		Reset();
+
+		FreeChunks(m_pFreeChunks);
+		m_pFreeChunks = nullptr;
+
+		assert(m_ChunksCount == 0);
+		assert(m_ReservedSize == 0);
+	}
+
+
+	size_t MemoryArena::GetChunkSize() const
+	{
+		return m_ChunkSize;
+	}
+
+
+	MemoryArenaChunkSource MemoryArena::GetChunkSource() const
+	{
+		return m_ChunkSource;
+	}
+
+
+	size_t MemoryArena::GetUsedSize() const
+	{
+		if (m_pUsedChunks == nullptr)
+		{
+			return m_UsedSizeBefore;
+		}
+
+		return m_UsedSizeBefore + (m_Current - GetChunkDataStart(m_pUsedChunks));
+	}
+
+
+	size_t MemoryArena::GetReservedSize() const
+	{
+		return m_ReservedSize;
+	}
+
+
+	int MemoryArena::GetChunksCount() const
+	{
+		return m_ChunksCount;
+	}
+
+
+	void* MemoryArena::AllocateFromNewChunk(size_t size, size_t alignment)
+	{
+		//chunk data is aligned by max_align_t, larger alignments may need padding up to the alignment
+		size_t requiredSize = ChunkHeaderSize + size + (alignment > alignof(std::max_align_t) ? alignment : 0);
+
+		if (requiredSize > m_ChunkSize)
+		{
+			//a dedicated chunk, the current one keeps serving the next requests
+			auto pChunk = AllocateChunk(requiredSize);
+
+			pChunk->m_pNext = m_pOversizedChunks;
+			m_pOversizedChunks = pChunk;
+
+			auto dataStart = GetChunkDataStart(pChunk);
+			auto start = (dataStart + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+			m_UsedSizeBefore += start + size - dataStart;
+
+			return reinterpret_cast<void*>(start);
+		}
+
+		//the rest of the current chunk is left unused
+		if (m_pUsedChunks != nullptr)
+		{
+			m_UsedSizeBefore += m_Current - GetChunkDataStart(m_pUsedChunks);
+		}
+
+		Chunk* pChunk;
+
+		if (m_pFreeChunks != nullptr)
+		{
+			pChunk = m_pFreeChunks;
+			m_pFreeChunks = pChunk->m_pNext;
+		}
+		else
+		{
+			pChunk = AllocateChunk(m_ChunkSize);
+		}
+
+		pChunk->m_pNext = m_pUsedChunks;
+		m_pUsedChunks = pChunk;
+
+		m_Current = GetChunkDataStart(pChunk);
+		m_End = reinterpret_cast<uintptr_t>(pChunk) + m_ChunkSize;
+
+		auto start = (m_Current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+		assert(start + size <= m_End);
+
+		m_Current = start + size;
+
+		return reinterpret_cast<void*>(start);
+	}
+
+
+	MemoryArena::Chunk* MemoryArena::AllocateChunk(size_t size)
+	{
+		void* pMemory = nullptr;
+
+		switch (m_ChunkSource)
+		{
+			case MemoryArenaChunkSource::Pool:
+				pMemory = MemoryPoolMultiThreaded::Allocate(size);
+				break;
+
+			case MemoryArenaChunkSource::Mmap:
+#ifdef _WIN32
+				//later: VirtualAlloc backed chunks
+				pMemory = std::malloc(size);
+#else
+				pMemory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+				if (pMemory == MAP_FAILED)
+				{
+					spdlog::error("Memory arena: failed to map {} bytes for a chunk", size);
+					pMemory = nullptr;
+				}
+#endif
+				break;
+		}
+
+		assert(pMemory != nullptr);
+
+		auto pChunk = static_cast<Chunk*>(pMemory);
+		pChunk->m_pNext = nullptr;
+		pChunk->m_Size = size;
+
+		m_ReservedSize += size;
+		m_ChunksCount++;
+
+		return pChunk;
+	}
+
+
+	void MemoryArena::FreeChunk(Chunk* pChunk)
+	{
+		size_t size = pChunk->m_Size;
+
+		m_ReservedSize -= size;
+		m_ChunksCount--;
+
+		switch (m_ChunkSource)
+		{
+			case MemoryArenaChunkSource::Pool:
+				MemoryPoolMultiThreaded::Deallocate(pChunk, size);
+				break;
+
+			case MemoryArenaChunkSource::Mmap:
+#ifdef _WIN32
+				std::free(pChunk);
+#else
+				munmap(pChunk, size);
+#endif
+				break;
+		}
+	}
+
+
+	void MemoryArena::FreeChunks(Chunk* pChunks)
+	{
+		while (pChunks != nullptr)
+		{
+			auto pChunk = pChunks;
+			pChunks = pChunk->m_pNext;
+
+			FreeChunk(pChunk);
+		}
+	}
+
+}
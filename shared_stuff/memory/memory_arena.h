@@ -0,0 +1,116 @@
+//
+// Created by Alexander on 29.10.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+namespace st::memory
+{
+	//where arena chunks come from
+	enum class MemoryArenaChunkSource
+	{
+		Pool,	//the multithreaded memory pool (expected to be initialized), chunks above its largest bucket are heap allocations
+		Mmap	//anonymous mappings, committed lazily (heap on platforms without mmap)
+	};
+
+
+	//-----
+	//monotonic (bump pointer) arena: items are carved one after another out of the current chunk and are never freed one by one,
+	//Reset drops all of them at once. Meant for short-lived data freed together: per request, per frame, temporary containers
+	//destructors of the objects in the arena are not called. Not thread safe, an arena is expected to be used by one thread at a time
+	//-----
+	class MemoryArena final
+	{
+	public:
+
+		static constexpr size_t DefaultChunkSize = 64 * 1024;
+
+		explicit MemoryArena(size_t chunkSize = DefaultChunkSize, MemoryArenaChunkSource chunkSource = MemoryArenaChunkSource::Mmap);
+		~MemoryArena();
+
+		MemoryArena(const MemoryArena&) = delete;
+		MemoryArena& operator=(const MemoryArena&) = delete;
+
+		//zero sized requests take a byte: every request gets a unique non-null pointer, as with operator new
+		[[nodiscard]] inline void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+		{
+			assert((alignment & (alignment - 1)) == 0);
+
+			size += size == 0 ? 1 : 0;
+
+			auto start = (m_Current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+			if (start + size <= m_End && start >= m_Current)
+			{
+				m_Current = start + size;
+				return reinterpret_cast<void*>(start);
+			}
+
+			return AllocateFromNewChunk(size, alignment);
+		}
+
+		template<typename T> [[nodiscard]] T* Allocate()
+		{
+			return reinterpret_cast<T*>(Allocate(sizeof(T), alignof(T)));
+		}
+
+		//all the items are dropped at once. Regular chunks are kept for the next items, the oversized ones go back to their source
+		void Reset();
+
+		//as Reset, and all the chunks go back to their source
+		void Release();
+
+		[[nodiscard]] size_t GetChunkSize() const;
+		[[nodiscard]] MemoryArenaChunkSource GetChunkSource() const;
+
+		//bytes handed out since the last reset, alignment padding included
+		[[nodiscard]] size_t GetUsedSize() const;
+
+		//bytes taken from the source by the chunks, both used and retained
+		[[nodiscard]] size_t GetReservedSize() const;
+		[[nodiscard]] int GetChunksCount() const;
+
+	private:
+
+		//placed at the start of every chunk
+		struct Chunk
+		{
+			Chunk* m_pNext;
+			size_t m_Size;
+		};
+
+		static constexpr size_t ChunkHeaderSize = (sizeof(Chunk) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+		static inline uintptr_t GetChunkDataStart(Chunk* pChunk)
+		{
+			return reinterpret_cast<uintptr_t>(pChunk) + ChunkHeaderSize;
+		}
+
+		void* AllocateFromNewChunk(size_t size, size_t alignment);
+
+		Chunk* AllocateChunk(size_t size);
+		void FreeChunk(Chunk* pChunk);
+		void FreeChunks(Chunk* pChunks);
+
+		const size_t m_ChunkSize;
+		const MemoryArenaChunkSource m_ChunkSource;
+
+		//bump range of the current chunk
+		uintptr_t m_Current;
+		uintptr_t m_End;
+
+		//the current chunk is the head of the used ones. Requests larger than a chunk get dedicated (oversized) chunks
+		Chunk* m_pUsedChunks;
+		Chunk* m_pOversizedChunks;
+		Chunk* m_pFreeChunks;
+
+		//used size of the chunks behind the current one and of the oversized ones
+		size_t m_UsedSizeBefore;
+		size_t m_ReservedSize;
+		int m_ChunksCount;
+	};
+}
@@ -0,0 +1,105 @@
+//
+// Created by Alexander on 31.10.2021.
+//
+
+#include <cstdlib>
+#include <algorithm>
+#include "memory_frame_allocator.h"
+#include "spdlog/spdlog.h"
+
+namespace st::memory
+{
+
+	//frame buffers follow each other in a single heap allocation, each one starting at a multiple of the min alignment
+	MemoryFrameAllocator::MemoryFrameAllocator(size_t frameCapacity, int framesCount) :
+			m_pBuffer(nullptr),
+			m_pFrameBuffer(nullptr),
+			m_FrameCapacity((frameCapacity + MinAlignment - 1) & ~(MinAlignment - 1)),
+			m_FramesCount(framesCount),
+			m_Top(0),
+			m_IsExhaustionReported(false),
+			m_FrameNumber(0),
+			m_LastFrameUsedSize(0),
+			m_PeakFrameUsedSize(0)
+	{
+		assert(m_FrameCapacity > 0);
+		assert(m_FramesCount >= MinFramesCount && m_FramesCount <= MaxFramesCount);
+
+		m_pBuffer = static_cast<char*>(std::malloc(m_FrameCapacity * m_FramesCount));
+		m_pFrameBuffer = m_pBuffer;
+
+		assert(m_pBuffer != nullptr);
+	}
+
+
+	MemoryFrameAllocator::~MemoryFrameAllocator()
+	{
+		std::free(m_pBuffer);
+	}
+
+
+	size_t MemoryFrameAllocator::AdvanceFrame()
+	{
+		size_t usedSize = m_Top.load(std::memory_order_relaxed);
+
+		m_LastFrameUsedSize = usedSize;
+		m_PeakFrameUsedSize = std::max(m_PeakFrameUsedSize, usedSize);
+
+		m_FrameNumber++;
+		m_pFrameBuffer = m_pBuffer + (m_FrameNumber % m_FramesCount) * m_FrameCapacity;
+
+		m_Top.store(0, std::memory_order_relaxed);
+		m_IsExhaustionReported.store(false, std::memory_order_relaxed);
+
+		return usedSize;
+	}
+
+
+	size_t MemoryFrameAllocator::GetFrameCapacity() const
+	{
+		return m_FrameCapacity;
+	}
+
+
+	int MemoryFrameAllocator::GetFramesCount() const
+	{
+		return m_FramesCount;
+	}
+
+
+	uint64_t MemoryFrameAllocator::GetFrameNumber() const
+	{
+		return m_FrameNumber;
+	}
+
+
+	size_t MemoryFrameAllocator::GetCurrentFrameUsedSize() const
+	{
+		return m_Top.load(std::memory_order_relaxed);
+	}
+
+
+	size_t MemoryFrameAllocator::GetLastFrameUsedSize() const
+	{
+		return m_LastFrameUsedSize;
+	}
+
+
+	size_t MemoryFrameAllocator::GetPeakFrameUsedSize() const
+	{
+		return m_PeakFrameUsedSize;
+	}
+
+
+	//the top keeps growing past the capacity, so the frame high-water mark shows how much it would have needed
+	void* MemoryFrameAllocator::OnExhausted(size_t size)
+	{
+		if (m_IsExhaustionReported.exchange(true, std::memory_order_relaxed) == false)
+		{
+			spdlog::error("Memory frame allocator: frame {} exhausted, {} bytes requested with {} bytes capacity", m_FrameNumber, size, m_FrameCapacity);
+		}
+
+		return nullptr;
+	}
+
+}
@@ -0,0 +1,100 @@
+//
+// Created by Alexander on 31.10.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+
+namespace st::memory
+{
+	//-----
+	//per frame scratch memory for frame loops: a buffer per frame in flight, the current one is bump allocated
+	//AdvanceFrame moves to the next buffer and resets it, so the memory of a frame stays valid for framesCount - 1 more frames
+	//(one extra frame double-buffered, two triple-buffered), while the GPU or the workers consume it.
+	//Allocate is thread safe (atomic bump, no locks), AdvanceFrame is expected to be called by the frame loop when the producers are done
+	//destructors of the objects in the frame memory are not called
+	//-----
+	class MemoryFrameAllocator final
+	{
+	public:
+
+		static constexpr int MinFramesCount = 2;
+		static constexpr int MaxFramesCount = 3;
+
+		explicit MemoryFrameAllocator(size_t frameCapacity, int framesCount = MinFramesCount);
+		~MemoryFrameAllocator();
+
+		MemoryFrameAllocator(const MemoryFrameAllocator&) = delete;
+		MemoryFrameAllocator& operator=(const MemoryFrameAllocator&) = delete;
+
+		//nullptr (and an error) if the frame buffer is exhausted
+		[[nodiscard]] inline void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+		{
+			assert((alignment & (alignment - 1)) == 0);
+
+			//offsets stay multiples of the min alignment, larger alignments reserve the padding they may need
+			size_t reservedSize = (size + MinAlignment - 1) & ~(MinAlignment - 1);
+
+			if (alignment > MinAlignment)
+			{
+				reservedSize += alignment - MinAlignment;
+			}
+
+			size_t offset = m_Top.fetch_add(reservedSize, std::memory_order_relaxed);
+
+			if (offset + reservedSize > m_FrameCapacity)
+			{
+				return OnExhausted(size);
+			}
+
+			auto start = reinterpret_cast<uintptr_t>(m_pFrameBuffer) + offset;
+			start = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+			return reinterpret_cast<void*>(start);
+		}
+
+		template<typename T> [[nodiscard]] T* Allocate(int count = 1)
+		{
+			return reinterpret_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		//the next frame reuses the oldest buffer. Returns the high-water mark of the finished frame
+		size_t AdvanceFrame();
+
+		[[nodiscard]] size_t GetFrameCapacity() const;
+		[[nodiscard]] int GetFramesCount() const;
+
+		//frames advanced so far
+		[[nodiscard]] uint64_t GetFrameNumber() const;
+
+		//bytes requested in the current frame, alignment padding included. May exceed the capacity if the frame ran out of it
+		[[nodiscard]] size_t GetCurrentFrameUsedSize() const;
+
+		//high-water marks of the last finished frame and of all the frames so far, for sizing the capacity
+		[[nodiscard]] size_t GetLastFrameUsedSize() const;
+		[[nodiscard]] size_t GetPeakFrameUsedSize() const;
+
+	private:
+
+		static constexpr size_t MinAlignment = alignof(std::max_align_t);
+
+		void* OnExhausted(size_t size);
+
+		char* m_pBuffer;
+		char* m_pFrameBuffer;
+
+		const size_t m_FrameCapacity;
+		const int m_FramesCount;
+
+		std::atomic<size_t> m_Top;
+		std::atomic<bool> m_IsExhaustionReported;
+
+		uint64_t m_FrameNumber;
+		size_t m_LastFrameUsedSize;
+		size_t m_PeakFrameUsedSize;
+	};
+}
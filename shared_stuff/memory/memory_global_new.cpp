@@ -0,0 +1,253 @@
+//
+// Created by Alexander on 24.10.2021.
+//
+
+//-----
+//global operator new/delete replacement, backed by MemoryPoolMultiThreaded
+//opt-in: built into the shared_stuff_global_new target only, link it to replace the operators for the whole executable
+//
+//requests that fit into the pool buckets are pooled while the pool is initialized, anything else goes to the system allocator:
+//large or over-aligned requests, allocations made before Init or after Release, and allocations made by the pool itself
+//deallocation tells pooled pointers from system ones by the pool page map
+//objects kept across Release are leaked when deleted: their pages were reported and kept by the released pool
+//-----
+
+#include <new>
+#include <cstdlib>
+#include <algorithm>
+#include "memory_pool.h"
+
+namespace
+{
+	using Pool = st::memory::MemoryPoolMultiThreaded;
+
+	using PoolScope = st::memory::MemoryPoolInternalScope;
+
+	//pooled items deleted from inside of the pool, returned by the next request from outside of it
+	thread_local void* s_pDeferredItems = nullptr;
+
+
+	//the same functions the pool uses for its oversized requests
+	void* SystemAllocate(size_t size, size_t alignment)
+	{
+#ifdef _WIN32
+		return _aligned_malloc(size, std::max(alignment, alignof(std::max_align_t)));
+#else
+		if (alignment <= alignof(std::max_align_t))
+		{
+			return std::malloc(size);
+		}
+
+		return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+	}
+
+	void SystemDeallocate(void* p)
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+
+
+	//the pool scope is expected to be active
+	void ReturnDeferredItems()
+	{
+		while (s_pDeferredItems != nullptr)
+		{
+			void* pItem = s_pDeferredItems;
+			s_pDeferredItems = *static_cast<void**>(pItem);
+
+			//the pool could have been released and initialized again since
+			if (st::memory::MemoryPoolPageMap::Contains(pItem))
+			{
+				Pool::Deallocate(pItem);
+			}
+		}
+	}
+
+
+	void* AllocateGlobal(size_t size, size_t alignment) noexcept
+	{
+		if (PoolScope::IsActive() == false && Pool::IsInitialized())
+		{
+			PoolScope scope;
+
+			if (s_pDeferredItems != nullptr)
+			{
+				ReturnDeferredItems();
+			}
+
+			//the default new alignment is kept for the sizes that may need it
+			size_t poolAlignment = size < __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? std::max(alignment, alignof(void*)) : std::max(alignment, (size_t)__STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+			void* pResult = Pool::TryAllocate(size, poolAlignment);
+
+			if (pResult != nullptr)
+			{
+				return pResult;
+			}
+		}
+
+		//zero sized requests still return unique pointers
+		return SystemAllocate(size > 0 ? size : 1, alignment);
+	}
+
+	void* AllocateGlobalOrThrow(size_t size, size_t alignment)
+	{
+		void* pResult = AllocateGlobal(size, alignment);
+
+		if (pResult == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+
+		return pResult;
+	}
+
+	void DeallocateGlobal(void* p) noexcept
+	{
+		if (p == nullptr)
+		{
+			return;
+		}
+
+		if (st::memory::MemoryPoolPageMap::Contains(p) == false)
+		{
+			//items of a released pool are leaked together with their pages
+			if (st::memory::MemoryPoolPageMap::IsOrphaned(p) == false)
+			{
+				SystemDeallocate(p);
+			}
+
+			return;
+		}
+
+		//the pool is being set up or released: the item may belong to the pool that is going away
+		if (Pool::IsInitialized() == false)
+		{
+			return;
+		}
+
+		if (PoolScope::IsActive())
+		{
+			*static_cast<void**>(p) = s_pDeferredItems;
+			s_pDeferredItems = p;
+			return;
+		}
+
+		PoolScope scope;
+		Pool::Deallocate(p);
+	}
+}
+
+
+//-----
+//replaceable allocation functions
+
+void* operator new(std::size_t size)
+{
+	return AllocateGlobalOrThrow(size, alignof(void*));
+}
+
+void* operator new[](std::size_t size)
+{
+	return AllocateGlobalOrThrow(size, alignof(void*));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return AllocateGlobal(size, alignof(void*));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return AllocateGlobal(size, alignof(void*));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return AllocateGlobalOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return AllocateGlobalOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return AllocateGlobal(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return AllocateGlobal(size, static_cast<size_t>(alignment));
+}
+
+
+//-----
+//replaceable deallocation functions
+//the pool finds the bucket by the pointer, so the sized and aligned variants don't need their arguments
+
+void operator delete(void* p) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	DeallocateGlobal(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+	DeallocateGlobal(p);
+}
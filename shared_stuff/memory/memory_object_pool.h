@@ -0,0 +1,406 @@
+//
+// Created by Alexander on 02.11.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include "memory_reference_counted.h"
+#include "memory_rcptr.h"
+#include "memory_allocator.h"
+#include "spdlog/spdlog.h"
+
+namespace st::memory
+{
+	template<typename T> class ObjectPool;
+
+
+	//objects with a Reset() method get it called when they go back to an ObjectPool
+	template<typename T, typename = void> struct ObjectPoolHasReset : std::false_type {};
+	template<typename T> struct ObjectPoolHasReset<T, std::void_t<decltype(std::declval<T&>().Reset())>> : std::true_type {};
+
+
+	//-----
+	//base of the reference counted objects recycled by an ObjectPool: when the last owner is gone,
+	//the object goes back to its pool instead of being deleted. Objects created outside of a pool are deleted as usual
+	//-----
+	template<typename T> class PooledReferenceCounted : public ReferenceCounted
+	{
+		friend class ObjectPool<T>;
+
+	protected:
+
+		PooledReferenceCounted() : m_pObjectPool(nullptr)
+		{
+
+		}
+
+		~PooledReferenceCounted() override = default;
+
+		void OnNoOwnersLeft() override
+		{
+			if (m_pObjectPool == nullptr)
+			{
+				ReferenceCounted::OnNoOwnersLeft();
+				return;
+			}
+
+			m_pObjectPool->Release(static_cast<T*>(this));
+		}
+
+	private:
+
+		ObjectPool<T>* m_pObjectPool;
+	};
+
+
+	//-----
+	//typed pool of constructed objects: released objects are not destroyed, they are kept constructed and handed out again,
+	//so expensive constructors and internal buffers are paid for once. A Reset() method of T (if any) is called on release
+	//objects live in pages: contiguous arrays of T, live ones are walked in storage order by ForEachLive. The pages come from the multithreaded memory pool
+	//not thread safe. Objects are handed out through Handles, or through rcptr for PooledReferenceCounted types
+	//-----
+	template<typename T> class ObjectPool final
+	{
+	public:
+
+		static constexpr int DefaultPageObjectsCount = 256;
+
+		//releases its object back to the pool when destroyed, move only
+		class Handle final
+		{
+		public:
+
+			Handle() : m_pObjectPool(nullptr), m_pObject(nullptr)
+			{
+
+			}
+
+			Handle(Handle&& other) noexcept : m_pObjectPool(other.m_pObjectPool), m_pObject(other.m_pObject)
+			{
+				other.m_pObjectPool = nullptr;
+				other.m_pObject = nullptr;
+			}
+
+			Handle& operator=(Handle&& other) noexcept
+			{
+				if (this != &other)
+				{
+					Release();
+
+					m_pObjectPool = other.m_pObjectPool;
+					m_pObject = other.m_pObject;
+
+					other.m_pObjectPool = nullptr;
+					other.m_pObject = nullptr;
+				}
+
+				return *this;
+			}
+
+			Handle(const Handle&) = delete;
+			Handle& operator=(const Handle&) = delete;
+
+			~Handle()
+			{
+				Release();
+			}
+
+			void Release()
+			{
+				if (m_pObject != nullptr)
+				{
+					m_pObjectPool->Release(m_pObject);
+
+					m_pObjectPool = nullptr;
+					m_pObject = nullptr;
+				}
+			}
+
+			[[nodiscard]] T* Get() const
+			{
+				return m_pObject;
+			}
+
+			T* operator->() const
+			{
+				assert(m_pObject != nullptr);
+				return m_pObject;
+			}
+
+			T& operator*() const
+			{
+				assert(m_pObject != nullptr);
+				return *m_pObject;
+			}
+
+			explicit operator bool() const
+			{
+				return m_pObject != nullptr;
+			}
+
+		private:
+
+			friend class ObjectPool;
+
+			Handle(ObjectPool* pObjectPool, T* pObject) : m_pObjectPool(pObjectPool), m_pObject(pObject)
+			{
+
+			}
+
+			ObjectPool* m_pObjectPool;
+			T* m_pObject;
+		};
+
+
+		explicit ObjectPool(int pageObjectsCount = DefaultPageObjectsCount) :
+				m_PageObjectsCount(pageObjectsCount),
+				m_LiveObjectsCount(0)
+		{
+			assert(m_PageObjectsCount > 0);
+		}
+
+		//all the constructed objects are destroyed, handles and pointers to them are expected to be gone by now
+		~ObjectPool()
+		{
+			if (m_LiveObjectsCount > 0)
+			{
+				spdlog::error("Object pool: destroyed with {} live objects", m_LiveObjectsCount);
+			}
+
+			for (auto& page : m_Pages)
+			{
+				for (int i = 0; i < page.m_ConstructedCount; i++)
+				{
+					page.GetObject(i)->~T();
+				}
+			}
+		}
+
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+
+		//a recycled object if there is one, otherwise a new one constructed with the args (which recycled objects don't get)
+		template<typename ... Args> [[nodiscard]] Handle Acquire(Args&& ... args)
+		{
+			return Handle(this, AcquireObject(std::forward<Args>(args)...));
+		}
+
+		//as Acquire, the object goes back to the pool when the last rcptr and wptr to it are gone
+		template<typename ... Args> [[nodiscard]] rcptr<T> AcquireShared(Args&& ... args)
+		{
+			static_assert(std::is_base_of_v<PooledReferenceCounted<T>, T>);
+
+			T* pObject = AcquireObject(std::forward<Args>(args)...);
+
+			if (pObject->m_pObjectPool != nullptr)
+			{
+				pObject->ResetReferenceCounts();
+			}
+
+			pObject->m_pObjectPool = this;
+
+			return rcptr<T>(pObject, true);
+		}
+
+		//live objects in storage order
+		template<typename TFunc> void ForEachLive(TFunc&& func)
+		{
+			for (auto& page : m_Pages)
+			{
+				for (int i = 0; i < page.m_ConstructedCount; i++)
+				{
+					if (page.m_IsLive[i])
+					{
+						func(*page.GetObject(i));
+					}
+				}
+			}
+		}
+
+		[[nodiscard]] int GetLiveObjectsCount() const
+		{
+			return m_LiveObjectsCount;
+		}
+
+		//live and recycled ones
+		[[nodiscard]] int GetConstructedObjectsCount() const
+		{
+			int result = 0;
+
+			for (auto& page : m_Pages)
+			{
+				result += page.m_ConstructedCount;
+			}
+
+			return result;
+		}
+
+		[[nodiscard]] int GetPagesCount() const
+		{
+			return (int)m_Pages.size();
+		}
+
+	private:
+
+		friend class PooledReferenceCounted<T>;
+
+		struct ObjectStorage
+		{
+			alignas(T) std::byte m_Data[sizeof(T)];
+		};
+
+		//objects are constructed in order and stay constructed until the pool is destroyed
+		struct Page
+		{
+			explicit Page(int objectsCount) :
+					m_pObjects(AllocatorMultiThreaded<ObjectStorage>().allocate(objectsCount)),
+					m_IsLive(AllocatorMultiThreaded<bool>().allocate(objectsCount)),
+					m_ObjectsCount(objectsCount),
+					m_ConstructedCount(0)
+			{
+
+			}
+
+			Page(Page&& other) noexcept :
+					m_pObjects(other.m_pObjects),
+					m_IsLive(other.m_IsLive),
+					m_ObjectsCount(other.m_ObjectsCount),
+					m_ConstructedCount(other.m_ConstructedCount)
+			{
+				other.m_pObjects = nullptr;
+				other.m_IsLive = nullptr;
+			}
+
+			Page(const Page&) = delete;
+			Page& operator=(const Page&) = delete;
+			Page& operator=(Page&&) = delete;
+
+			//the objects are destroyed by the pool
+			~Page()
+			{
+				if (m_pObjects != nullptr)
+				{
+					AllocatorMultiThreaded<ObjectStorage>().deallocate(m_pObjects, m_ObjectsCount);
+					AllocatorMultiThreaded<bool>().deallocate(m_IsLive, m_ObjectsCount);
+				}
+			}
+
+			[[nodiscard]] inline T* GetObject(int index) const
+			{
+				return std::launder(reinterpret_cast<T*>(&m_pObjects[index]));
+			}
+
+			[[nodiscard]] inline uintptr_t GetStart() const
+			{
+				return reinterpret_cast<uintptr_t>(m_pObjects);
+			}
+
+			ObjectStorage* m_pObjects;
+			bool* m_IsLive;
+			int m_ObjectsCount;
+			int m_ConstructedCount;
+		};
+
+		struct PageAddress
+		{
+			uintptr_t m_Start;
+			int m_PageIndex;
+		};
+
+		template<typename ... Args> T* AcquireObject(Args&& ... args)
+		{
+			T* pObject;
+
+			if (m_RecycledObjects.empty() == false)
+			{
+				//the last released object is the most likely to be in the cache
+				pObject = m_RecycledObjects.back();
+				m_RecycledObjects.pop_back();
+			}
+			else
+			{
+				if (m_Pages.empty() || m_Pages.back().m_ConstructedCount == m_PageObjectsCount)
+				{
+					AddPage();
+				}
+
+				auto& page = m_Pages.back();
+
+				pObject = new (&page.m_pObjects[page.m_ConstructedCount]) T(std::forward<Args>(args)...);
+				page.m_IsLive[page.m_ConstructedCount] = false;
+				page.m_ConstructedCount++;
+			}
+
+			SetLive(pObject, true);
+			m_LiveObjectsCount++;
+
+			return pObject;
+		}
+
+		void Release(T* pObject)
+		{
+			assert(pObject != nullptr);
+
+			if constexpr(ObjectPoolHasReset<T>::value)
+			{
+				pObject->Reset();
+			}
+
+			SetLive(pObject, false);
+			m_LiveObjectsCount--;
+
+			m_RecycledObjects.push_back(pObject);
+		}
+
+		void AddPage()
+		{
+			m_Pages.emplace_back(m_PageObjectsCount);
+
+			PageAddress pageAddress{m_Pages.back().GetStart(), (int)m_Pages.size() - 1};
+
+			auto search = std::lower_bound(m_PageAddresses.begin(), m_PageAddresses.end(), pageAddress.m_Start, [](const PageAddress& address, uintptr_t start)
+			{
+				return address.m_Start < start;
+			});
+
+			m_PageAddresses.insert(search, pageAddress);
+		}
+
+		//the page is the last one starting at or before the object
+		void SetLive(T* pObject, bool isLive)
+		{
+			auto address = reinterpret_cast<uintptr_t>(pObject);
+
+			auto search = std::upper_bound(m_PageAddresses.begin(), m_PageAddresses.end(), address, [](uintptr_t address, const PageAddress& pageAddress)
+			{
+				return address < pageAddress.m_Start;
+			});
+
+			assert(search != m_PageAddresses.begin());
+			search--;
+
+			auto& page = m_Pages[search->m_PageIndex];
+			auto index = (int)((address - page.GetStart()) / sizeof(ObjectStorage));
+
+			assert(index < page.m_ConstructedCount);
+			assert(page.m_IsLive[index] != isLive);
+
+			page.m_IsLive[index] = isLive;
+		}
+
+		const int m_PageObjectsCount;
+		int m_LiveObjectsCount;
+
+		std::vector<Page> m_Pages;
+		std::vector<PageAddress> m_PageAddresses;
+		std::vector<T*> m_RecycledObjects;
+	};
+}
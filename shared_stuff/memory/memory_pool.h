@@ -7,12 +7,31 @@
 #include <cstddef>
 #include <type_traits>
 #include <mutex>
+#include <condition_variable>
 #include <cassert>
-#include <map>
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "memory_settings.h"
 #include "internal/memory_pool_bucket.h"
+#include "internal/memory_pool_page_map.h"
+#include "internal/memory_pool_internal_scope.h"
+#include "internal/memory_pool_profile.h"
+#include "internal/memory_pool_size_lookup.h"
+#include "internal/memory_pool_checks.h"
+#include "internal/memory_pool_leak_tracker.h"
 #include "spdlog/spdlog.h"
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef MEMORY_POOL_PROFILING
+#include <map>
+#endif
+
 namespace st::memory
 {
 	template<bool isThreadSafe> class MemoryPool final
@@ -50,28 +69,153 @@ namespace st::memory
 		{
 			if constexpr(isThreadSafe)
 			{
+				//the provisioner takes m_Mutex itself, it's stopped before the lock
+				StopProvisioner();
+
+				//quarantined items are deallocated the usual way, which may take m_Mutex
+				FlushQuarantine();
+
 				std::lock_guard lock(m_Mutex);
 				DoRelease();
 			}
 			else
 			{
+				FlushQuarantine();
 				DoRelease();
 			}
 		}
 
-		[[nodiscard]] static void* Allocate(size_t size)
+		//gives the memory of empty pages back to the system: empty extra pages above retainedEmptyPagesCount are freed,
+		//the retained ones are decommitted. Calling it periodically with a small count decays the pool down to its working set
+		//lock-free buckets are never trimmed, in thread owned mode only the calling thread's heap is, in per cpu mode all the shards are.
+		//returns the amount of bytes freed or decommitted
+		static size_t Trim(int retainedEmptyPagesCount = 0)
 		{
 			if constexpr(isThreadSafe)
 			{
+				assert(s_pInstance != nullptr);
+
+				if (s_pInstance->m_IsThreadOwned)
+				{
+					auto pHeap = GetThreadHeapHolder().GetValidHeap();
+					return pHeap != nullptr ? pHeap->Trim(retainedEmptyPagesCount) : 0;
+				}
+
+				//shards are locked one by one
+				if (s_pInstance->m_IsPerCpu)
+				{
+					size_t result = 0;
+
+					for (auto pShard : s_pInstance->m_CpuShards)
+					{
+						result += pShard->Trim(retainedEmptyPagesCount);
+					}
+
+					return result;
+				}
+
 				std::lock_guard lock(m_Mutex);
+
+				//items cached by the calling thread may be the last ones keeping their pages
+				if (s_pInstance->m_ThreadCachesEnabled)
+				{
+					GetThreadCache().FlushAll();
+				}
+
+				return s_pInstance->DoTrim(retainedEmptyPagesCount);
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				return s_pInstance->DoTrim(retainedEmptyPagesCount);
+			}
+		}
+
+		//the requests histogram collected so far, for GetProfileGuidedMemoryPoolSettings. Empty without MEMORY_POOL_PROFILING
+		[[nodiscard]] static MemoryPoolProfile GetProfile()
+		{
+			assert(s_pInstance != nullptr);
+
+			MemoryPoolProfile profile;
+
+#ifdef MEMORY_POOL_PROFILING
+			//the profile allocates under the profiling mutex
+			MemoryPoolInternalScope scope;
+			std::lock_guard lock(s_pInstance->m_ProfilingMutex);
+
+			for (auto& [size, requestsTotal] : s_pInstance->m_Requests_Total)
+			{
+				profile.AddSizeRequests(size, requestsTotal, s_pInstance->m_Requests_Max[size]);
+			}
+#else
+			spdlog::warn("Memory pool: requests profile is only collected with MEMORY_POOL_PROFILING defined");
+#endif
+
+			return profile;
+		}
+
+		//saved before Release, the profile is loaded by MemoryPoolProfile::LoadFromFile for the next runs
+		static bool SaveProfile(const std::string& filePath)
+		{
+			return GetProfile().SaveToFile(filePath);
+		}
+
+		//live requests of the bucket that serves the size, 0 without MEMORY_POOL_STATISTICS
+		//the thread safe pool merges the counters of the calling thread first, the other threads merge theirs every ThreadStatistics::MergeInterval requests
+		[[nodiscard]] static int64_t GetCurrentRequestsCount(size_t size)
+		{
+			assert(s_pInstance != nullptr);
+
+#ifdef MEMORY_POOL_STATISTICS
+			if constexpr(isThreadSafe)
+			{
+				GetThreadStatistics().Merge();
+			}
+
+			return s_pInstance->m_Statistics[GetStatisticsIndex(s_pInstance->GetBucketIndex(size))].m_RequestsCurrent;
+#else
+			return 0;
+#endif
+		}
+
+		//live sampled allocations grouped by call site, the most bytes first. Empty without MEMORY_POOL_LEAK_TRACKING
+		//the report of the allocations still live on Release is logged by the pool itself
+		[[nodiscard]] static std::vector<MemoryPoolLeakTracker::CallSiteReport> GetLeakReport()
+		{
+			assert(s_pInstance != nullptr);
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			return s_pInstance->m_pLeakTracker->GetReport();
+#else
+			spdlog::warn("Memory pool: allocations are only tracked with MEMORY_POOL_LEAK_TRACKING defined");
+			return {};
+#endif
+		}
+
+		static void LogLeakReport()
+		{
+			assert(s_pInstance != nullptr);
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			s_pInstance->m_pLeakTracker->LogReport(GetPoolName());
+#else
+			spdlog::warn("Memory pool: allocations are only tracked with MEMORY_POOL_LEAK_TRACKING defined");
+#endif
+		}
+
+		[[nodiscard]] static void* Allocate(size_t size)
+		{
+			if constexpr(isThreadSafe)
+			{
 				assert(s_pInstance != nullptr);
-				return s_pInstance->DoAllocate(size);
+				return DoAllocateThreadSafe(size, s_pInstance->GetBucketIndex(size));
 			}
 			else
 			{
 				assert(s_pInstance != nullptr);
 				assert(s_InitThreadID == std::this_thread::get_id());
-				return s_pInstance->DoAllocate(size);
+				return s_pInstance->DoAllocate(size, s_pInstance->GetBucketIndex(size));
 			}
 		}
 
@@ -79,15 +223,63 @@ namespace st::memory
 		{
 			if constexpr(isThreadSafe)
 			{
-				std::lock_guard lock(m_Mutex);
 				assert(s_pInstance != nullptr);
-				return reinterpret_cast<T*>(s_pInstance->DoAllocate(sizeof(T)));
+				return reinterpret_cast<T*>(DoAllocateThreadSafe(sizeof(T), s_pInstance->template GetBucketIndex<T>(), alignof(T)));
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				return reinterpret_cast<T*>(s_pInstance->DoAllocate(sizeof(T), s_pInstance->template GetBucketIndex<T>(), alignof(T)));
+			}
+		}
+
+		//allocates from the buckets only: nullptr if the request doesn't fit into them (or the pool isn't initialized)
+		[[nodiscard]] static void* TryAllocate(size_t size, size_t alignment = DefaultAlignment)
+		{
+			if (s_pInstance == nullptr)
+			{
+				return nullptr;
+			}
+
+			int bucketIndex = s_pInstance->GetBucketIndex(size, alignment);
+
+			if (bucketIndex == InvalidIndex)
+			{
+				return nullptr;
+			}
+
+			if constexpr(isThreadSafe)
+			{
+				return DoAllocateThreadSafe(size, bucketIndex, alignment);
+			}
+			else
+			{
+				assert(s_InitThreadID == std::this_thread::get_id());
+				return s_pInstance->DoAllocate(size, bucketIndex, alignment);
+			}
+		}
+
+		//false while the pool is being set up or released: the pool may be used by the global operator new from then on
+		[[nodiscard]] static bool IsInitialized()
+		{
+			return s_IsAvailable.load(std::memory_order_acquire);
+		}
+
+		//the item comes from the smallest bucket that fits the size and is aligned enough
+		//the same alignment is expected by Deallocate
+		[[nodiscard]] static void* Allocate(size_t size, size_t alignment)
+		{
+			if constexpr(isThreadSafe)
+			{
+				assert(s_pInstance != nullptr);
+				return DoAllocateThreadSafe(size, s_pInstance->GetBucketIndex(size, alignment), alignment);
 			}
 			else
 			{
 				assert(s_pInstance != nullptr);
 				assert(s_InitThreadID == std::this_thread::get_id());
-				return reinterpret_cast<T*>(s_pInstance->DoAllocate(sizeof(T)));
+				return s_pInstance->DoAllocate(size, s_pInstance->GetBucketIndex(size, alignment), alignment);
 			}
 		}
 
@@ -95,15 +287,14 @@ namespace st::memory
 		{
 			if constexpr(isThreadSafe)
 			{
-				std::lock_guard lock(m_Mutex);
 				assert(s_pInstance != nullptr);
-				s_pInstance->DoDeallocate(pointer, size);
+				DoDeallocateThreadSafe(pointer, size, s_pInstance->GetBucketIndex(size));
 			}
 			else
 			{
 				assert(s_pInstance != nullptr);
 				assert(s_InitThreadID == std::this_thread::get_id());
-				s_pInstance->DoDeallocate(pointer, size);
+				s_pInstance->DoDeallocate(pointer, size, s_pInstance->GetBucketIndex(size));
 			}
 		}
 
@@ -111,48 +302,229 @@ namespace st::memory
 		{
 			if constexpr(isThreadSafe)
 			{
-				std::lock_guard lock(m_Mutex);
 				assert(s_pInstance != nullptr);
-				s_pInstance->DoDeallocate(pointer, sizeof(T));
+				DoDeallocateThreadSafe(pointer, sizeof(T), s_pInstance->template GetBucketIndex<T>(), alignof(T));
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				s_pInstance->DoDeallocate(pointer, sizeof(T), s_pInstance->template GetBucketIndex<T>(), alignof(T));
+			}
+		}
+
+		//size-free deallocation: pooled items are recognized by the page map, their bucket is found through the slab header
+		//anything else is an oversized heap allocation. Sized deallocation is still cheaper
+		static void Deallocate(void* pointer)
+		{
+			assert(s_pInstance != nullptr);
+
+			int bucketIndex = s_pInstance->GetBucketIndex(pointer);
+
+			if (bucketIndex == ForeignIndex)
+			{
+				DeallocateForeign(pointer);
+				return;
+			}
+
+			if constexpr(isThreadSafe)
+			{
+				DoDeallocateThreadSafe(pointer, UnknownSize, bucketIndex);
+			}
+			else
+			{
+				assert(s_InitThreadID == std::this_thread::get_id());
+				s_pInstance->DoDeallocate(pointer, UnknownSize, bucketIndex);
+			}
+		}
+
+		static void Deallocate(void* pointer, size_t size, size_t alignment)
+		{
+			if constexpr(isThreadSafe)
+			{
+				assert(s_pInstance != nullptr);
+				DoDeallocateThreadSafe(pointer, size, s_pInstance->GetBucketIndex(size, alignment), alignment);
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				s_pInstance->DoDeallocate(pointer, size, s_pInstance->GetBucketIndex(size, alignment), alignment);
+			}
+		}
+
+		//batch requests: count items of the same size with a single bucket lookup and a single lock
+		//the items come from the shared buckets (or the calling thread's heap), the thread caches are skipped
+		//items of a batch can be freed one by one and vice versa. Oversized requests are served one by one
+		static void AllocateBatch(size_t size, int count, void** pOut)
+		{
+			if constexpr(isThreadSafe)
+			{
+				assert(s_pInstance != nullptr);
+				DoAllocateBatchThreadSafe(size, s_pInstance->GetBucketIndex(size), count, pOut);
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				s_pInstance->DoAllocateBatch(size, s_pInstance->GetBucketIndex(size), count, pOut);
+			}
+		}
+
+		template<typename T> static void AllocateBatch(int count, T** pOut)
+		{
+			if constexpr(isThreadSafe)
+			{
+				assert(s_pInstance != nullptr);
+				DoAllocateBatchThreadSafe(sizeof(T), s_pInstance->template GetBucketIndex<T>(), count, reinterpret_cast<void**>(pOut), alignof(T));
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				s_pInstance->DoAllocateBatch(sizeof(T), s_pInstance->template GetBucketIndex<T>(), count, reinterpret_cast<void**>(pOut), alignof(T));
+			}
+		}
+
+		static void DeallocateBatch(void** pItems, int count, size_t size)
+		{
+			if constexpr(isThreadSafe)
+			{
+				assert(s_pInstance != nullptr);
+				DoDeallocateBatchThreadSafe(pItems, count, size, s_pInstance->GetBucketIndex(size));
+			}
+			else
+			{
+				assert(s_pInstance != nullptr);
+				assert(s_InitThreadID == std::this_thread::get_id());
+				s_pInstance->DoDeallocateBatch(pItems, count, size, s_pInstance->GetBucketIndex(size));
+			}
+		}
+
+		template<typename T> static void DeallocateBatch(T** pItems, int count)
+		{
+			if constexpr(isThreadSafe)
+			{
+				assert(s_pInstance != nullptr);
+				DoDeallocateBatchThreadSafe(reinterpret_cast<void**>(pItems), count, sizeof(T), s_pInstance->template GetBucketIndex<T>());
 			}
 			else
 			{
 				assert(s_pInstance != nullptr);
 				assert(s_InitThreadID == std::this_thread::get_id());
-				s_pInstance->DoDeallocate(pointer, sizeof(T));
+				s_pInstance->DoDeallocateBatch(reinterpret_cast<void**>(pItems), count, sizeof(T), s_pInstance->template GetBucketIndex<T>());
 			}
 		}
 
 
 	private:
 
-		static constexpr int InvalidIndex = -1;
+		//pool instances share the heap functions for the requests that don't fit into the buckets
+		template<bool> friend class MemoryPoolInstance;
+
+		//size-free deallocations of the other static pool items are routed to it
+		template<bool> friend class MemoryPool;
+
+		static constexpr int InvalidIndex = MemoryPoolSizeLookup::InvalidIndex;
+
+		//pooled items that belong to another pool: the other static pool or a pool instance
+		static constexpr int ForeignIndex = InvalidIndex - 1;
+
+		//malloc alignment, requests that don't fit into the buckets and need more go to the aligned heap functions
+		static constexpr size_t DefaultAlignment = alignof(std::max_align_t);
+
+		//size of size-free deallocations
+		static constexpr size_t UnknownSize = 0;
 
 		MemoryPool() = default;
 
-		MemoryPool(const MemoryPoolSettings& settings) : m_Requests_Total(), m_Requests_Current()
+		MemoryPool(const MemoryPoolSettings& settings) :
+				m_IsLockFree(isThreadSafe && settings.GetSyncMode() == MemoryPoolSyncMode::LockFree),
+				m_IsThreadOwned(isThreadSafe && settings.GetSyncMode() == MemoryPoolSyncMode::ThreadOwned),
+				m_IsPerCpu(isThreadSafe && settings.GetSyncMode() == MemoryPoolSyncMode::PerCpu),
+				m_ThreadCachesEnabled(isThreadSafe && settings.GetThreadCacheItemsCount() > 0 && !m_IsThreadOwned && !m_IsPerCpu),
+				m_ThreadCacheCapacities(),
+				m_IsProvisioningEnabled(isThreadSafe && settings.IsBackgroundProvisioningEnabled() && settings.GetSyncMode() == MemoryPoolSyncMode::Mutex),
+				m_Provisioner(),
+				m_ProvisioningCondition(),
+				m_IsProvisioningRequested(false),
+				m_IsProvisionerStopping(false),
+				m_HeapSettings(),
+				m_ThreadHeaps(),
+				m_AbandonedThreadHeaps(),
+				m_CpuShards(),
+				m_Statistics()
 		{
 			m_BucketsCount = settings.GetBucketsCount();
 			assert(m_BucketsCount > 0);
 
 			for (int i = 0; i < m_BucketsCount; i++)
 			{
-				m_Buckets[i].Setup(settings.GetBucketDefinition(i));
+				auto bucketDefinition = settings.GetBucketDefinition(i);
+
+				//thread heaps are created on demand and cpu shards may never be used, nothing is pre-warmed for them
+				if (m_IsThreadOwned || m_IsPerCpu)
+				{
+					bucketDefinition.m_PreWarmFirstPage = false;
+					m_HeapSettings.AddBucketDefinition(bucketDefinition);
+				}
+
+				m_Buckets[i].Setup(bucketDefinition, m_IsLockFree, settings.GetRetainedEmptyPagesCount(), settings.GetMaxExtraPageSize());
+				m_Buckets[i].SetOwner(GetBucketsOwner());
+
+				if (m_ThreadCachesEnabled)
+				{
+					m_ThreadCacheCapacities[i] = settings.GetThreadCacheCapacity(i);
+				}
+			}
+
+			m_HeapSettings.SetRetainedEmptyPagesCount(settings.GetRetainedEmptyPagesCount());
+			m_HeapSettings.SetMaxExtraPageSize(settings.GetMaxExtraPageSize());
+
+			if (m_IsPerCpu)
+			{
+				int cpuShardsCount = settings.GetCpuShardsCount() > 0 ? settings.GetCpuShardsCount() : (int)std::thread::hardware_concurrency();
+
+				for (int i = 0; i < std::max(cpuShardsCount, 1); i++)
+				{
+					m_CpuShards.push_back(new CpuShard(m_HeapSettings));
+				}
+			}
+
+			if (settings.IsBackgroundProvisioningEnabled() && m_IsProvisioningEnabled == false)
+			{
+				spdlog::warn("Memory pool: background provisioning is only supported by the thread safe pool in the mutex mode, ignored");
 			}
+
+			m_SizeLookup.Build(m_Buckets, m_BucketsCount);
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			m_pLeakTracker = std::make_unique<MemoryPoolLeakTracker>(settings.GetLeakTrackingSampleInterval());
+#endif
+
+			m_UsesDefaultSizeClasses = settings.UsesDefaultSizeClasses();
 		}
 
 		static inline void DoInit()
 		{
-			assert(s_pInstance == nullptr);
-			s_InitThreadID = std::this_thread::get_id();
-			s_pInstance = new MemoryPool(GetDefaultMemoryPoolSettings(isThreadSafe));
+			DoInit(GetDefaultMemoryPoolSettings(isThreadSafe));
 		}
 
 		static inline void DoInit(const MemoryPoolSettings& settings)
 		{
+			MemoryPoolInternalScope scope;
+
 			assert(s_pInstance == nullptr);
 			s_InitThreadID = std::this_thread::get_id();
 			s_pInstance = new MemoryPool(settings);
+			s_Generation++;
+			s_IsAvailable.store(true, std::memory_order_release);
+
+			//the provisioner waits for m_Mutex, which is held by Init
+			if (s_pInstance->m_IsProvisioningEnabled)
+			{
+				s_pInstance->m_Provisioner = std::thread(&MemoryPool::RunProvisioner, s_pInstance);
+			}
 		}
 
 		static inline void DoRelease()
@@ -160,140 +532,1592 @@ namespace st::memory
 			assert(s_pInstance != nullptr);
 			assert(s_InitThreadID == std::this_thread::get_id());
 
-			s_pInstance->LogStatistics();
-
-			delete s_pInstance;
-			s_pInstance = nullptr;
-		}
+			MemoryPoolInternalScope scope;
 
-		inline void* DoAllocate(size_t size)
-		{
-			RegisterRequestAllocate(size);
+			s_IsAvailable.store(false, std::memory_order_release);
 
-			int bucketIndex = GetBucketIndex(size);
+			//items cached by the releasing thread go back to the buckets
+			//other threads are expected to be finished by now, their caches are flushed on thread exit
+			if constexpr(isThreadSafe)
+			{
+				GetThreadCache().FlushAll();
+			}
 
-			if (bucketIndex == InvalidIndex)
+			//thread heaps go away together with the pool, whether their threads are finished or not
+			if constexpr(isThreadSafe)
 			{
-				return std::malloc(size);
+				s_pInstance->ReleaseThreadHeaps();
+				s_pInstance->ReleaseCpuShards();
 			}
-			else
+
+#ifdef MEMORY_POOL_STATISTICS
+			if constexpr(isThreadSafe)
 			{
-				return m_Buckets[bucketIndex].Allocate();
+				GetThreadStatistics().Merge();
 			}
+#endif
+
+			s_pInstance->LogStatistics();
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			//who allocated the pointers the buckets are about to report as unreleased
+			s_pInstance->m_pLeakTracker->LogReport(GetPoolName());
+#endif
+
+			delete s_pInstance;
+			s_pInstance = nullptr;
 		}
 
-		inline void DoDeallocate(void* pointer, size_t size)
+		inline void* DoAllocate(size_t size, int bucketIndex, size_t alignment = DefaultAlignment)
 		{
-			RegisterRequestDeallocate(size);
+			RegisterAllocate(size, bucketIndex);
 
-			int bucketIndex = GetBucketIndex(size);
+			return OnAllocated(DoAllocateUncounted(size, bucketIndex, alignment), size, bucketIndex);
+		}
 
-			if (bucketIndex == InvalidIndex)
+		inline void DoDeallocate(void* pointer, size_t size, int bucketIndex, [[maybe_unused]] size_t alignment = DefaultAlignment)
+		{
+			//frees rejected by the checked mode are not counted
+			if (CheckDeallocation(pointer, size, bucketIndex) == false)
 			{
-				std::free(pointer);
+				return;
 			}
-			else
+
+			RegisterDeallocate(size, bucketIndex);
+			OnDeallocated(pointer, bucketIndex);
+
+			if (Quarantine(pointer, size, bucketIndex))
 			{
-				m_Buckets[bucketIndex].Deallocate(pointer);
+				DoDeallocateUncounted(pointer, size, bucketIndex);
 			}
 		}
 
-		inline int GetBucketIndex(size_t size)
+		inline void DoAllocateBatch(size_t size, int bucketIndex, int count, void** pOut, size_t alignment = DefaultAlignment)
 		{
-			assert(m_BucketsCount > 0);
+			RegisterAllocate(size, bucketIndex, count);
 
-			int maxIndex = m_BucketsCount - 1;
+			DoAllocateBatchUncounted(size, bucketIndex, count, pOut, alignment);
+			OnAllocatedBatch(pOut, count, size, bucketIndex);
+		}
 
-			if (m_Buckets[maxIndex].GetItemSize() < size)
+		inline void DoDeallocateBatch(void** pItems, int count, size_t size, int bucketIndex)
+		{
+#ifdef MEMORY_POOL_CHECKED
+			//items are checked and quarantined one by one
+			for (int i = 0; i < count; i++)
 			{
-				return InvalidIndex;
+				DoDeallocate(pItems[i], size, bucketIndex);
 			}
+#else
+			RegisterDeallocate(size, bucketIndex, count);
+			OnDeallocatedBatch(pItems, count, bucketIndex);
 
-			for (int i = 0; i < m_BucketsCount; i++)
+			DoDeallocateBatchUncounted(pItems, count, bucketIndex);
+#endif
+		}
+
+		//m_Mutex is expected to be locked for mutex synchronized buckets
+		inline void DoAllocateBatchUncounted(size_t size, int bucketIndex, int count, void** pOut, size_t alignment)
+		{
+			if (bucketIndex == InvalidIndex)
 			{
-				if (m_Buckets[i].GetItemSize() >= size)
+				for (int i = 0; i < count; i++)
 				{
-					return i;
+					pOut[i] = AllocateOversized(size, alignment);
 				}
+
+				return;
 			}
 
-			assert(false);
-			return InvalidIndex;
+			AllocateBatchFromBucket(bucketIndex, count, pOut);
 		}
 
-		//statistics
-		inline void RegisterRequestAllocate(size_t size)
+		//m_Mutex is expected to be locked for mutex synchronized buckets
+		inline void DoDeallocateBatchUncounted(void** pItems, int count, int bucketIndex)
 		{
-			//total
+			if (bucketIndex == InvalidIndex)
 			{
-				auto search = m_Requests_Total.find(size);
-				if (search != m_Requests_Total.end())
+				for (int i = 0; i < count; i++)
 				{
-					search->second++;
+					DeallocateOversized(pItems[i]);
 				}
-				else
-				{
+
+				return;
+			}
+
+			DeallocateBatchToBucket(bucketIndex, pItems, count);
+		}
+
+		inline void* DoAllocateUncounted(size_t size, int bucketIndex, size_t alignment = DefaultAlignment)
+		{
+			if (bucketIndex == InvalidIndex)
+			{
+				return AllocateOversized(size, alignment);
+			}
+			else
+			{
+				void* pResult = m_Buckets[bucketIndex].Allocate();
+				CheckProvisioning(bucketIndex);
+
+				return pResult;
+			}
+		}
+
+		inline void DoDeallocateUncounted(void* pointer, [[maybe_unused]] size_t size, int bucketIndex)
+		{
+			if (bucketIndex == InvalidIndex)
+			{
+				DeallocateOversized(pointer);
+			}
+			else
+			{
+				m_Buckets[bucketIndex].Deallocate(pointer);
+			}
+		}
+
+		//thread safe paths: allocations that fit into buckets are served by the calling thread's heap or cache,
+		//or straight by lock-free buckets. Requests are counted by the calling thread and merged into the pool statistics in batches
+		//bucket item sizes never change after Init, so the bucket lookup itself doesn't need the lock
+		static inline void* DoAllocateThreadSafe(size_t size, int bucketIndex, size_t alignment = DefaultAlignment)
+		{
+			assert(s_pInstance != nullptr);
+
+			s_pInstance->RegisterAllocate(size, bucketIndex);
+
+			return OnAllocated(DoAllocateThreadSafeUncounted(size, bucketIndex, alignment), size, bucketIndex);
+		}
+
+		static inline void* DoAllocateThreadSafeUncounted(size_t size, int bucketIndex, size_t alignment)
+		{
+			if (bucketIndex != InvalidIndex)
+			{
+				if (s_pInstance->m_IsThreadOwned)
+				{
+					return GetThreadHeap()->Allocate(bucketIndex);
+				}
+
+				if (s_pInstance->m_IsPerCpu)
+				{
+					return GetCpuShard()->Allocate(bucketIndex);
+				}
+
+				if (s_pInstance->m_ThreadCachesEnabled)
+				{
+					return GetThreadCache().Allocate(bucketIndex);
+				}
+
+				if (s_pInstance->m_IsLockFree)
+				{
+					return s_pInstance->m_Buckets[bucketIndex].AllocateLockFree();
+				}
+			}
+
+			std::lock_guard lock(m_Mutex);
+			return s_pInstance->DoAllocateUncounted(size, bucketIndex, alignment);
+		}
+
+		static inline void DoDeallocateThreadSafe(void* pointer, size_t size, int bucketIndex, [[maybe_unused]] size_t alignment = DefaultAlignment)
+		{
+			assert(s_pInstance != nullptr);
+
+			//frees rejected by the checked mode are not counted
+			if (s_pInstance->CheckDeallocation(pointer, size, bucketIndex) == false)
+			{
+				return;
+			}
+
+			s_pInstance->RegisterDeallocate(size, bucketIndex);
+			OnDeallocated(pointer, bucketIndex);
+
+			if (s_pInstance->Quarantine(pointer, size, bucketIndex))
+			{
+				DoDeallocateThreadSafeUncounted(pointer, size, bucketIndex);
+			}
+		}
+
+		static inline void DoDeallocateThreadSafeUncounted(void* pointer, size_t size, int bucketIndex)
+		{
+			if (bucketIndex != InvalidIndex)
+			{
+				if (s_pInstance->m_IsThreadOwned)
+				{
+					ThreadHeap::Deallocate(pointer);
+					return;
+				}
+
+				if (s_pInstance->m_IsPerCpu)
+				{
+					CpuShard::Deallocate(pointer);
+					return;
+				}
+
+				if (s_pInstance->m_ThreadCachesEnabled)
+				{
+					GetThreadCache().Deallocate(bucketIndex, pointer);
+					return;
+				}
+
+				if (s_pInstance->m_IsLockFree)
+				{
+					s_pInstance->m_Buckets[bucketIndex].DeallocateLockFree(pointer);
+					return;
+				}
+			}
+
+			std::lock_guard lock(m_Mutex);
+			s_pInstance->DoDeallocateUncounted(pointer, size, bucketIndex);
+		}
+
+		static inline void DoAllocateBatchThreadSafe(size_t size, int bucketIndex, int count, void** pOut, size_t alignment = DefaultAlignment)
+		{
+			assert(s_pInstance != nullptr);
+
+			s_pInstance->RegisterAllocate(size, bucketIndex, count);
+
+			DoAllocateBatchThreadSafeUncounted(size, bucketIndex, count, pOut, alignment);
+			OnAllocatedBatch(pOut, count, size, bucketIndex);
+		}
+
+		static inline void DoAllocateBatchThreadSafeUncounted(size_t size, int bucketIndex, int count, void** pOut, size_t alignment)
+		{
+			if (bucketIndex == InvalidIndex || s_pInstance->m_IsLockFree)
+			{
+				s_pInstance->DoAllocateBatchUncounted(size, bucketIndex, count, pOut, alignment);
+				return;
+			}
+
+			if (s_pInstance->m_IsThreadOwned)
+			{
+				GetThreadHeap()->AllocateBatch(bucketIndex, count, pOut);
+				return;
+			}
+
+			if (s_pInstance->m_IsPerCpu)
+			{
+				GetCpuShard()->AllocateBatch(bucketIndex, count, pOut);
+				return;
+			}
+
+			std::lock_guard lock(m_Mutex);
+			s_pInstance->DoAllocateBatchUncounted(size, bucketIndex, count, pOut, alignment);
+		}
+
+		static inline void DoDeallocateBatchThreadSafe(void** pItems, int count, size_t size, int bucketIndex)
+		{
+			assert(s_pInstance != nullptr);
+
+#ifdef MEMORY_POOL_CHECKED
+			//items are checked and quarantined one by one
+			for (int i = 0; i < count; i++)
+			{
+				DoDeallocateThreadSafe(pItems[i], size, bucketIndex);
+			}
+
+			return;
+#endif
+
+			s_pInstance->RegisterDeallocate(size, bucketIndex, count);
+			OnDeallocatedBatch(pItems, count, bucketIndex);
+
+			if (bucketIndex == InvalidIndex || s_pInstance->m_IsLockFree)
+			{
+				s_pInstance->DoDeallocateBatchUncounted(pItems, count, bucketIndex);
+				return;
+			}
+
+			if (s_pInstance->m_IsThreadOwned)
+			{
+				ThreadHeap::DeallocateBatch(pItems, count);
+				return;
+			}
+
+			if (s_pInstance->m_IsPerCpu)
+			{
+				CpuShard::DeallocateBatch(pItems, count);
+				return;
+			}
+
+			std::lock_guard lock(m_Mutex);
+			s_pInstance->DoDeallocateBatchUncounted(pItems, count, bucketIndex);
+		}
+
+		//-----
+		//checked mode (MEMORY_POOL_CHECKED), see MemoryPoolChecks: items are checked as they are handed out,
+		//valid frees wait in the quarantine, the item that leaves it is the one deallocated instead
+		//leak tracking mode (MEMORY_POOL_LEAK_TRACKING), see MemoryPoolLeakTracker: sampled allocations are tracked until freed
+
+		static inline void* OnAllocated(void* pointer, [[maybe_unused]] size_t size, [[maybe_unused]] int bucketIndex)
+		{
+#ifdef MEMORY_POOL_CHECKED
+			if (bucketIndex != InvalidIndex)
+			{
+				MemoryPoolChecks::OnAllocate(pointer, size);
+			}
+#endif
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			if (pointer != nullptr && s_pInstance->m_pLeakTracker->ShouldSample())
+			{
+				//sampled items are flagged in their slabs, so the frees of the others don't reach the tracker
+				if (bucketIndex != InvalidIndex)
+				{
+					auto pSlab = MemoryPoolSlab::FromPointer(pointer);
+					pSlab->GetItemSampledFlags()[pSlab->GetItemIndex(pointer)] = 1;
+				}
+
+				s_pInstance->m_pLeakTracker->OnAllocate(pointer, size);
+			}
+#endif
+
+			return pointer;
+		}
+
+		//oversized allocations have no slab to be flagged in, their frees are always looked up by the tracker
+		static inline void OnDeallocated([[maybe_unused]] void* pointer, [[maybe_unused]] int bucketIndex)
+		{
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			if (bucketIndex != InvalidIndex)
+			{
+				auto pSlab = MemoryPoolSlab::FromPointer(pointer);
+				auto& sampled = pSlab->GetItemSampledFlags()[pSlab->GetItemIndex(pointer)];
+
+				if (sampled == 0)
+				{
+					return;
+				}
+
+				sampled = 0;
+			}
+
+			s_pInstance->m_pLeakTracker->OnDeallocate(pointer);
+#endif
+		}
+
+		static inline void OnDeallocatedBatch([[maybe_unused]] void** pItems, [[maybe_unused]] int count, [[maybe_unused]] int bucketIndex)
+		{
+#ifdef MEMORY_POOL_LEAK_TRACKING
+			for (int i = 0; i < count; i++)
+			{
+				OnDeallocated(pItems[i], bucketIndex);
+			}
+#endif
+		}
+
+		static inline void OnAllocatedBatch([[maybe_unused]] void** pItems, [[maybe_unused]] int count, [[maybe_unused]] size_t size, [[maybe_unused]] int bucketIndex)
+		{
+#if defined(MEMORY_POOL_CHECKED) || defined(MEMORY_POOL_LEAK_TRACKING)
+			for (int i = 0; i < count; i++)
+			{
+				OnAllocated(pItems[i], size, bucketIndex);
+			}
+#endif
+		}
+
+		//false for the frees the checked mode rejects (they are reported and ignored). Valid items are poisoned, ready for the quarantine
+		inline bool CheckDeallocation([[maybe_unused]] void* pointer, [[maybe_unused]] size_t size, [[maybe_unused]] int bucketIndex)
+		{
+#ifdef MEMORY_POOL_CHECKED
+			if (bucketIndex != InvalidIndex)
+			{
+				return MemoryPoolChecks::OnDeallocate(pointer, size, m_Buckets[bucketIndex].GetItemSize());
+			}
+#endif
+
+			return true;
+		}
+
+		//false if there is nothing to deallocate now: the quarantine isn't full yet
+		//otherwise pointer and bucketIndex are the ones to be deallocated. The item is expected to have passed CheckDeallocation
+		inline bool Quarantine([[maybe_unused]] void*& pointer, [[maybe_unused]] size_t size, [[maybe_unused]] int& bucketIndex)
+		{
+#ifdef MEMORY_POOL_CHECKED
+			if (bucketIndex == InvalidIndex)
+			{
+				return true;
+			}
+
+			MemoryPoolQuarantine::Item releasedItem;
+
+			if constexpr(isThreadSafe)
+			{
+				std::lock_guard lock(m_QuarantineMutex);
+				releasedItem = m_Quarantine.Push({pointer, bucketIndex});
+			}
+			else
+			{
+				releasedItem = m_Quarantine.Push({pointer, bucketIndex});
+			}
+
+			if (releasedItem.m_pPointer == nullptr)
+			{
+				return false;
+			}
+
+			MemoryPoolChecks::OnRelease(releasedItem.m_pPointer);
+
+			pointer = releasedItem.m_pPointer;
+			bucketIndex = releasedItem.m_BucketIndex;
+#endif
+
+			return true;
+		}
+
+		//quarantined items go back to their buckets, before the pool is released
+		static void FlushQuarantine()
+		{
+#ifdef MEMORY_POOL_CHECKED
+			assert(s_pInstance != nullptr);
+
+			while (true)
+			{
+				MemoryPoolQuarantine::Item item;
+
+				if constexpr(isThreadSafe)
+				{
+					std::lock_guard lock(s_pInstance->m_QuarantineMutex);
+					item = s_pInstance->m_Quarantine.Pop();
+				}
+				else
+				{
+					item = s_pInstance->m_Quarantine.Pop();
+				}
+
+				if (item.m_pPointer == nullptr)
+				{
+					break;
+				}
+
+				MemoryPoolChecks::OnRelease(item.m_pPointer);
+
+				if constexpr(isThreadSafe)
+				{
+					DoDeallocateThreadSafeUncounted(item.m_pPointer, UnknownSize, item.m_BucketIndex);
+				}
+				else
+				{
+					s_pInstance->DoDeallocateUncounted(item.m_pPointer, UnknownSize, item.m_BucketIndex);
+				}
+			}
+#endif
+		}
+
+		//the owner of this pool's buckets (its own ones, thread heaps and cpu shards), pool instances own their buckets themselves
+		[[nodiscard]] static inline void* GetBucketsOwner()
+		{
+			return &s_BucketsOwner;
+		}
+
+		//items of the other static pool go back to it, the items of pool instances are reported and left alone
+		static void DeallocateForeign(void* pointer)
+		{
+			using OtherPool = MemoryPool<!isThreadSafe>;
+
+			if (MemoryPoolSlab::FromPointer(pointer)->m_pBucket->GetOwner() == OtherPool::GetBucketsOwner() && OtherPool::s_pInstance != nullptr)
+			{
+				OtherPool::Deallocate(pointer);
+				return;
+			}
+
+			spdlog::error("Memory pool ({}): size-free deallocation of an item that belongs to another pool, ignored. Pointer: {}", GetPoolName(), pointer);
+		}
+
+		//oversized allocations are freed the same way whatever their alignment, so size-free deallocation works for them too
+		static inline void* AllocateOversized(size_t size, size_t alignment)
+		{
+			assert((alignment & (alignment - 1)) == 0);
+
+#ifdef _WIN32
+			return _aligned_malloc(size, std::max(alignment, DefaultAlignment));
+#else
+			if (alignment <= DefaultAlignment)
+			{
+				return std::malloc(size);
+			}
+
+			//the size has to be a multiple of the alignment
+			return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+		}
+
+		static inline void DeallocateOversized(void* pointer)
+		{
+#ifdef _WIN32
+			_aligned_free(pointer);
+#else
+			std::free(pointer);
+#endif
+		}
+
+		//m_Mutex is expected to be locked for mutex synchronized buckets
+		inline void* AllocateFromBucket(int bucketIndex)
+		{
+			if (m_IsLockFree)
+			{
+				return m_Buckets[bucketIndex].AllocateLockFree();
+			}
+
+			void* pResult = m_Buckets[bucketIndex].Allocate();
+			CheckProvisioning(bucketIndex);
+
+			return pResult;
+		}
+
+		//m_Mutex is expected to be locked for mutex synchronized buckets
+		inline void DeallocateToBucket(int bucketIndex, void* pointer)
+		{
+			if (m_IsLockFree)
+			{
+				m_Buckets[bucketIndex].DeallocateLockFree(pointer);
+				return;
+			}
+
+			m_Buckets[bucketIndex].Deallocate(pointer);
+		}
+
+		//m_Mutex is expected to be locked for mutex synchronized buckets
+		inline void AllocateBatchFromBucket(int bucketIndex, int count, void** pOut)
+		{
+			if (m_IsLockFree)
+			{
+				m_Buckets[bucketIndex].AllocateBatchLockFree(pOut, count);
+				return;
+			}
+
+			m_Buckets[bucketIndex].AllocateBatch(pOut, count);
+			CheckProvisioning(bucketIndex);
+		}
+
+		//m_Mutex is expected to be locked for mutex synchronized buckets
+		inline void DeallocateBatchToBucket(int bucketIndex, void** pItems, int count)
+		{
+			if (m_IsLockFree)
+			{
+				m_Buckets[bucketIndex].DeallocateBatchLockFree(pItems, count);
+				return;
+			}
+
+			m_Buckets[bucketIndex].DeallocateBatch(pItems, count);
+		}
+
+		//-----
+		//background provisioning: allocations from mutex synchronized buckets wake the provisioner once a bucket runs low,
+		//it creates the pages without the lock and adds them under it, so allocations don't wait for page creation
+
+		//m_Mutex is expected to be locked
+		inline void CheckProvisioning(int bucketIndex)
+		{
+			if constexpr(isThreadSafe)
+			{
+				if (m_IsProvisioningEnabled && m_Buckets[bucketIndex].NeedsProvisioning() && m_IsProvisioningRequested == false)
+				{
+					m_IsProvisioningRequested = true;
+					m_ProvisioningCondition.notify_one();
+				}
+			}
+		}
+
+		void RunProvisioner()
+		{
+			std::unique_lock lock(m_Mutex);
+
+			while (true)
+			{
+				m_ProvisioningCondition.wait(lock, [this] { return m_IsProvisioningRequested || m_IsProvisionerStopping; });
+
+				if (m_IsProvisionerStopping)
+				{
+					return;
+				}
+
+				m_IsProvisioningRequested = false;
+
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					auto& bucket = m_Buckets[i];
+
+					if (bucket.NeedsProvisioning() == false)
+					{
+						continue;
+					}
+
+					int itemsCount = bucket.GetNextExtraPageItemsCount();
+					int slabsCount;
+
+					lock.unlock();
+					auto pPage = bucket.PreparePage(itemsCount, slabsCount);
+					lock.lock();
+
+					bucket.AddPreparedPage(pPage, slabsCount);
+				}
+			}
+		}
+
+		//m_Mutex is expected to be unlocked
+		static void StopProvisioner()
+		{
+			assert(s_pInstance != nullptr);
+
+			if (s_pInstance->m_Provisioner.joinable() == false)
+			{
+				return;
+			}
+
+			{
+				std::lock_guard lock(m_Mutex);
+				s_pInstance->m_IsProvisionerStopping = true;
+			}
+
+			s_pInstance->m_ProvisioningCondition.notify_one();
+			s_pInstance->m_Provisioner.join();
+		}
+
+		//m_Mutex is expected to be locked for the thread safe pool
+		size_t DoTrim(int retainedEmptyPagesCount)
+		{
+			size_t result = 0;
+
+			for (int i = 0; i < m_BucketsCount; i++)
+			{
+				result += m_Buckets[i].Trim(retainedEmptyPagesCount);
+			}
+
+			return result;
+		}
+
+		//typed lookup: with the default size classes the bucket index is a compile time constant
+		//runtime configured pools fall back to the lookup tables
+		template<typename T> inline int GetBucketIndex()
+		{
+			constexpr int defaultBucketIndex = GetDefaultSizeClassIndex(sizeof(T), alignof(T));
+
+			if (m_UsesDefaultSizeClasses)
+			{
+				return defaultBucketIndex;
+			}
+
+			return GetBucketIndex(sizeof(T), alignof(T));
+		}
+
+		//the bucket item size leads back to the bucket: item sizes are unique, so this is the smallest bucket that fits it
+		//ForeignIndex for the items of other pools, which must not get into these buckets
+		inline int GetBucketIndex(void* pointer)
+		{
+			if (pointer == nullptr || MemoryPoolPageMap::Contains(pointer) == false)
+			{
+				return InvalidIndex;
+			}
+
+			auto pSlab = MemoryPoolSlab::FromPointer(pointer);
+
+			if (pSlab->m_pBucket->GetOwner() != GetBucketsOwner())
+			{
+				return ForeignIndex;
+			}
+
+			int bucketIndex = GetBucketIndex((size_t)pSlab->m_ItemSize);
+
+			assert(bucketIndex != InvalidIndex);
+			assert(m_Buckets[bucketIndex].GetItemSize() == pSlab->m_ItemSize);
+
+			return bucketIndex;
+		}
+
+		inline int GetBucketIndex(size_t size, size_t alignment) const
+		{
+			return m_SizeLookup.GetBucketIndex(size, alignment);
+		}
+
+		inline int GetBucketIndex(size_t size) const
+		{
+			return m_SizeLookup.GetBucketIndex(size);
+		}
+
+		//-----
+		//statistics
+		//requests are counted per bucket, the last slot counts the requests that don't fit into the buckets
+		//the single threaded pool counts them directly, the thread safe one per thread (see ThreadStatistics),
+		//so its max values are estimated from every thread's own peak between merges
+		//-----
+		static constexpr int OversizedStatisticsIndex = MemoryPoolSettings::MaxBucketsCount;
+		static constexpr int StatisticsCount = MemoryPoolSettings::MaxBucketsCount + 1;
+
+		using StatisticsCounter = std::conditional_t<isThreadSafe, std::atomic<int64_t>, int64_t>;
+
+		struct BucketStatistics
+		{
+			StatisticsCounter m_RequestsTotal;
+			StatisticsCounter m_RequestsCurrent;
+			StatisticsCounter m_RequestsMax;
+
+			//single threaded pool only
+			inline void RegisterAllocate(int count)
+			{
+				m_RequestsTotal += count;
+				m_RequestsCurrent += count;
+
+				if (m_RequestsCurrent > m_RequestsMax)
+				{
+					m_RequestsMax = m_RequestsCurrent;
+				}
+			}
+
+			//single threaded pool only
+			inline void RegisterDeallocate(int count)
+			{
+				m_RequestsCurrent -= count;
+			}
+
+			//thread safe pool only
+			//currentDelta: allocations minus deallocations since the last merge, maxDelta: the highest value it had in between
+			void Merge(int64_t allocationsCount, int64_t currentDelta, int64_t maxDelta)
+			{
+				m_RequestsTotal.fetch_add(allocationsCount, std::memory_order_relaxed);
+
+				int64_t current = m_RequestsCurrent.fetch_add(currentDelta, std::memory_order_relaxed) + maxDelta;
+				int64_t max = m_RequestsMax.load(std::memory_order_relaxed);
+
+				while (current > max && !m_RequestsMax.compare_exchange_weak(max, current, std::memory_order_relaxed))
+				{
+
+				}
+			}
+		};
+
+		static inline int GetStatisticsIndex(int bucketIndex)
+		{
+			return bucketIndex != InvalidIndex ? bucketIndex : OversizedStatisticsIndex;
+		}
+
+		//count: batch requests are registered at once
+		inline void RegisterAllocate([[maybe_unused]] size_t size, [[maybe_unused]] int bucketIndex, [[maybe_unused]] int count = 1)
+		{
+#ifdef MEMORY_POOL_STATISTICS
+			if constexpr(isThreadSafe)
+			{
+				GetThreadStatistics().RegisterAllocate(GetStatisticsIndex(bucketIndex), count);
+			}
+			else
+			{
+				m_Statistics[GetStatisticsIndex(bucketIndex)].RegisterAllocate(count);
+			}
+#endif
+
+#ifdef MEMORY_POOL_PROFILING
+			MemoryPoolInternalScope scope;
+			std::lock_guard lock(m_ProfilingMutex);
+
+			for (int i = 0; i < count; i++)
+			{
+				RegisterProfilingAllocate(size);
+			}
+#endif
+		}
+
+		inline void RegisterDeallocate([[maybe_unused]] size_t size, [[maybe_unused]] int bucketIndex, [[maybe_unused]] int count = 1)
+		{
+#ifdef MEMORY_POOL_STATISTICS
+			if constexpr(isThreadSafe)
+			{
+				GetThreadStatistics().RegisterDeallocate(GetStatisticsIndex(bucketIndex), count);
+			}
+			else
+			{
+				m_Statistics[GetStatisticsIndex(bucketIndex)].RegisterDeallocate(count);
+			}
+#endif
+
+#ifdef MEMORY_POOL_PROFILING
+			MemoryPoolInternalScope scope;
+			std::lock_guard lock(m_ProfilingMutex);
+
+			//the requested size of size-free deallocations is unknown, the histogram current values don't include them
+			if (size == UnknownSize)
+			{
+				m_Requests_UnsizedDeallocations += count;
+			}
+			else
+			{
+				for (int i = 0; i < count; i++)
+				{
+					RegisterProfilingDeallocate(size);
+				}
+			}
+#endif
+		}
+
+#ifdef MEMORY_POOL_PROFILING
+		//m_ProfilingMutex is expected to be locked
+		inline void RegisterProfilingAllocate(size_t size)
+		{
+			//total
+			{
+				auto search = m_Requests_Total.find(size);
+				if (search != m_Requests_Total.end())
+				{
+					search->second++;
+				}
+				else
+				{
 					m_Requests_Total[size] = 1;
 				}
 			}
 
-			//max
+			//max
+			{
+				auto search = m_Requests_Current.find(size);
+				if (search != m_Requests_Current.end())
+				{
+					search->second++;
+
+					auto inMax = m_Requests_Max.find(size);
+
+					if (inMax->second < search->second)
+					{
+						inMax->second = search->second;
+					}
+				}
+				else
+				{
+					m_Requests_Current[size] = 1;
+					m_Requests_Max[size] = 1;
+				}
+			}
+		}
+
+		//m_ProfilingMutex is expected to be locked
+		inline void RegisterProfilingDeallocate(size_t size)
+		{
+			//total - no need
+
+			//max
+			{
+				auto search = m_Requests_Current.find(size);
+				if (search != m_Requests_Current.end())
+				{
+					search->second--;
+				}
+				else
+				{
+					spdlog::error("Memory pool: deallocation request for size [{}] with no previous allocation request registered!", size);
+				}
+			}
+		}
+#endif
+
+		static constexpr const char* GetPoolName()
+		{
+			return isThreadSafe ? "Multi-threaded" : "Single threaded";
+		}
+
+		void LogStatistics()
+		{
+			[[maybe_unused]] const char* pPoolName = GetPoolName();
+
+#ifdef MEMORY_POOL_STATISTICS
+			spdlog::info("Memory Pool ({}) buckets stats:", pPoolName);
+
+			auto logBucketStatistics = [this](int statisticsIndex)
+			{
+				auto& statistics = m_Statistics[statisticsIndex];
+				int64_t requestsTotal = statistics.m_RequestsTotal;
+
+				if (requestsTotal == 0)
+				{
+					return;
+				}
+
+				int64_t requestsCurrent = statistics.m_RequestsCurrent;
+				int64_t requestsMax = statistics.m_RequestsMax;
+
+				if (statisticsIndex == OversizedStatisticsIndex)
+				{
+					spdlog::info("   oversized requests. Total: {}   Current: {}   Max: {}", requestsTotal, requestsCurrent, requestsMax);
+				}
+				else
+				{
+					spdlog::info("   bucket [{}] requests. Total: {}   Current: {}   Max: {}", m_Buckets[statisticsIndex].GetItemSize(), requestsTotal, requestsCurrent, requestsMax);
+				}
+			};
+
+			for (int i = 0; i < m_BucketsCount; i++)
+			{
+				logBucketStatistics(i);
+			}
+
+			logBucketStatistics(OversizedStatisticsIndex);
+#endif
+
+#ifdef MEMORY_POOL_PROFILING
+			spdlog::info("Memory Pool ({}) requests stats:", pPoolName);
+
+			for(auto& [key, value] : m_Requests_Total)
+			{
+				auto requestsMax = m_Requests_Max[key];
+
+				spdlog::info("   [{}] requests. Total: {}   Max: {}", key, value, requestsMax);
+			}
+
+			if (m_Requests_UnsizedDeallocations > 0)
+			{
+				spdlog::info("   size-free deallocations: {}", m_Requests_UnsizedDeallocations);
+			}
+#endif
+		}
+
+
+		//-----
+		//per thread requests counters of the thread safe pool
+		//merged into the pool statistics every MergeInterval requests, on Release and on thread exit
+		class ThreadStatistics final
+		{
+		public:
+
+			static constexpr int MergeInterval = 4096;
+
+			ThreadStatistics() : m_Generation(0), m_RequestsCount(0), m_AllocationsCount(), m_CurrentDelta(), m_MaxDelta()
+			{
+
+			}
+
+			~ThreadStatistics()
+			{
+				std::lock_guard lock(m_Mutex);
+				Merge();
+			}
+
+			inline void RegisterAllocate(int statisticsIndex, int count)
+			{
+				Validate();
+
+				m_AllocationsCount[statisticsIndex] += count;
+				m_CurrentDelta[statisticsIndex] += count;
+
+				if (m_CurrentDelta[statisticsIndex] > m_MaxDelta[statisticsIndex])
+				{
+					m_MaxDelta[statisticsIndex] = m_CurrentDelta[statisticsIndex];
+				}
+
+				m_RequestsCount += count;
+
+				if (m_RequestsCount >= MergeInterval)
+				{
+					Merge();
+				}
+			}
+
+			inline void RegisterDeallocate(int statisticsIndex, int count)
+			{
+				Validate();
+
+				m_CurrentDelta[statisticsIndex] -= count;
+				m_RequestsCount += count;
+
+				if (m_RequestsCount >= MergeInterval)
+				{
+					Merge();
+				}
+			}
+
+			//the pool is expected to stay alive: either m_Mutex is locked or the calling thread is using the pool
+			void Merge()
+			{
+				if (s_pInstance == nullptr || m_Generation != s_Generation)
+				{
+					return;
+				}
+
+				auto mergeCounters = [this](int statisticsIndex)
+				{
+					s_pInstance->m_Statistics[statisticsIndex].Merge(m_AllocationsCount[statisticsIndex], m_CurrentDelta[statisticsIndex], m_MaxDelta[statisticsIndex]);
+
+					m_AllocationsCount[statisticsIndex] = 0;
+					m_CurrentDelta[statisticsIndex] = 0;
+					m_MaxDelta[statisticsIndex] = 0;
+				};
+
+				for (int i = 0; i < s_pInstance->m_BucketsCount; i++)
+				{
+					mergeCounters(i);
+				}
+
+				mergeCounters(OversizedStatisticsIndex);
+
+				m_RequestsCount = 0;
+			}
+
+		private:
+
+			//counters of a previous pool are dropped
+			inline void Validate()
+			{
+				if (m_Generation == s_Generation)
+				{
+					return;
+				}
+
+				std::fill(std::begin(m_AllocationsCount), std::end(m_AllocationsCount), 0);
+				std::fill(std::begin(m_CurrentDelta), std::end(m_CurrentDelta), 0);
+				std::fill(std::begin(m_MaxDelta), std::end(m_MaxDelta), 0);
+				m_RequestsCount = 0;
+
+				m_Generation = s_Generation;
+			}
+
+			int m_Generation;
+			int m_RequestsCount;
+			int64_t m_AllocationsCount[StatisticsCount];
+			int64_t m_CurrentDelta[StatisticsCount];
+			int64_t m_MaxDelta[StatisticsCount];
+		};
+
+		static inline ThreadStatistics& GetThreadStatistics()
+		{
+			return MemoryPoolThreadLocal<ThreadStatistics>::Get();
+		}
+
+
+		//-----
+		//per thread cache of free items, one items stack per bucket
+		//refills from and flushes to the shared buckets in batches, taking m_Mutex once per batch (if buckets aren't lock-free)
+		class ThreadCache final
+		{
+		public:
+
+			ThreadCache() : m_Generation(0), m_IsDestroyed(false), m_Items()
+			{
+
+			}
+
+			//other thread local destructors may still allocate or deallocate after this one (global operator new replacement),
+			//those requests go straight to the shared buckets
+			~ThreadCache()
+			{
+				std::lock_guard lock(m_Mutex);
+				FlushAll();
+
+				m_IsDestroyed = true;
+				m_Generation = InvalidIndex;
+			}
+
+			inline void* Allocate(int bucketIndex)
+			{
+				if (Validate() == false)
+				{
+					return AllocateFromSharedBucket(bucketIndex);
+				}
+
+				auto& items = m_Items[bucketIndex];
+
+				if (items.empty())
+				{
+					if (s_pInstance->m_IsLockFree)
+					{
+						Refill(bucketIndex);
+					}
+					else
+					{
+						std::lock_guard lock(m_Mutex);
+						Refill(bucketIndex);
+					}
+				}
+
+				auto pResult = items.back();
+				items.pop_back();
+
+				return pResult;
+			}
+
+			inline void Deallocate(int bucketIndex, void* pointer)
 			{
-				auto search = m_Requests_Current.find(size);
-				if (search != m_Requests_Current.end())
+				if (Validate() == false)
 				{
-					search->second++;
+					DeallocateToSharedBucket(bucketIndex, pointer);
+					return;
+				}
 
-					auto inMax = m_Requests_Max.find(size);
+				auto& items = m_Items[bucketIndex];
+				int capacity = s_pInstance->m_ThreadCacheCapacities[bucketIndex];
 
-					if (inMax->second < search->second)
+				if (items.capacity() == 0)
+				{
+					Reserve(bucketIndex);
+				}
+
+				if ((int)items.size() >= capacity)
+				{
+					if (s_pInstance->m_IsLockFree)
 					{
-						inMax->second = search->second;
+						Flush(bucketIndex, capacity / 2);
+					}
+					else
+					{
+						std::lock_guard lock(m_Mutex);
+						Flush(bucketIndex, capacity / 2);
 					}
 				}
-				else
+
+				items.push_back(pointer);
+			}
+
+			//m_Mutex is expected to be locked
+			void FlushAll()
+			{
+				if (s_pInstance == nullptr || m_Generation != s_Generation)
 				{
-					m_Requests_Current[size] = 1;
-					m_Requests_Max[size] = 1;
+					return;
+				}
+
+				for (int i = 0; i < s_pInstance->m_BucketsCount; i++)
+				{
+					Flush(i, (int)m_Items[i].size());
+				}
+			}
+
+		private:
+
+			//the pool could have been released and initialized again since the last call
+			//items of the previous pool are dropped: their pages are reported as unreleased by the previous pool
+			//false if the cache is already destroyed
+			inline bool Validate()
+			{
+				if (m_Generation == s_Generation)
+				{
+					return true;
+				}
+
+				if (m_IsDestroyed)
+				{
+					return false;
+				}
+
+				for (auto& items : m_Items)
+				{
+					items.clear();
+				}
+
+				m_Generation = s_Generation;
+
+				return true;
+			}
+
+			static void* AllocateFromSharedBucket(int bucketIndex)
+			{
+				if (s_pInstance->m_IsLockFree)
+				{
+					return s_pInstance->AllocateFromBucket(bucketIndex);
+				}
+
+				std::lock_guard lock(m_Mutex);
+				return s_pInstance->AllocateFromBucket(bucketIndex);
+			}
+
+			static void DeallocateToSharedBucket(int bucketIndex, void* pointer)
+			{
+				if (s_pInstance->m_IsLockFree)
+				{
+					s_pInstance->DeallocateToBucket(bucketIndex, pointer);
+					return;
+				}
+
+				std::lock_guard lock(m_Mutex);
+				s_pInstance->DeallocateToBucket(bucketIndex, pointer);
+			}
+
+			//the only allocation of the cache, flushes keep the items count below the capacity
+			void Reserve(int bucketIndex)
+			{
+				MemoryPoolInternalScope scope;
+				m_Items[bucketIndex].reserve(s_pInstance->m_ThreadCacheCapacities[bucketIndex]);
+			}
+
+			//m_Mutex is expected to be locked for mutex synchronized buckets
+			void Refill(int bucketIndex)
+			{
+				auto& items = m_Items[bucketIndex];
+				int capacity = s_pInstance->m_ThreadCacheCapacities[bucketIndex];
+
+				if (items.capacity() == 0)
+				{
+					Reserve(bucketIndex);
+				}
+
+				int batchSize = std::max(1, capacity / 2);
+
+				//refills happen on empty caches only, the batch is within the reserved capacity
+				assert(items.empty());
+				items.resize(batchSize);
+				s_pInstance->AllocateBatchFromBucket(bucketIndex, batchSize, items.data());
+			}
+
+			//m_Mutex is expected to be locked for mutex synchronized buckets
+			//the oldest items go back to the bucket, recently freed (cache-hot) ones stay in the cache
+			void Flush(int bucketIndex, int itemsCount)
+			{
+				auto& items = m_Items[bucketIndex];
+
+				assert(itemsCount <= (int)items.size());
+
+				if (itemsCount == 0)
+				{
+					return;
 				}
+
+				s_pInstance->DeallocateBatchToBucket(bucketIndex, items.data(), itemsCount);
+
+				items.erase(items.begin(), items.begin() + itemsCount);
 			}
+
+			int m_Generation;
+			bool m_IsDestroyed;
+
+			std::vector<void*> m_Items[MemoryPoolSettings::MaxBucketsCount];
+		};
+
+		static inline ThreadCache& GetThreadCache()
+		{
+			return MemoryPoolThreadLocal<ThreadCache>::Get();
 		}
 
-		inline void RegisterRequestDeallocate(size_t size)
+
+		//-----
+		//thread owned mode: every thread allocates from its own heap without any synchronization
+		//a deallocation from another thread goes to the remote free list of the owning bucket, found through the slab header
+		//the owner reclaims remote frees in one batch on its next allocation from that bucket
+		//heaps of finished threads are abandoned and adopted by new threads, all heaps are destroyed by Release
+		class ThreadHeap final
 		{
-			//total - no need
+		public:
 
-			//max
+			explicit ThreadHeap(const MemoryPoolSettings& settings) : m_BucketsCount(settings.GetBucketsCount())
 			{
-				auto search = m_Requests_Current.find(size);
-				if (search != m_Requests_Current.end())
+				for (int i = 0; i < m_BucketsCount; i++)
 				{
-					search->second--;
+					m_Buckets[i].Setup(settings.GetBucketDefinition(i), false, settings.GetRetainedEmptyPagesCount(), settings.GetMaxExtraPageSize());
+					m_Buckets[i].SetOwner(GetBucketsOwner());
+				}
+			}
+
+			size_t Trim(int retainedEmptyPagesCount)
+			{
+				size_t result = 0;
+
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					result += m_Buckets[i].Trim(retainedEmptyPagesCount);
+				}
+
+				return result;
+			}
+
+			inline void* Allocate(int bucketIndex)
+			{
+				auto& bucket = m_Buckets[bucketIndex];
+
+				bucket.ReclaimRemoteItems();
+
+				return bucket.Allocate();
+			}
+
+			inline void AllocateBatch(int bucketIndex, int count, void** pOut)
+			{
+				auto& bucket = m_Buckets[bucketIndex];
+
+				bucket.ReclaimRemoteItems();
+				bucket.AllocateBatch(pOut, count);
+			}
+
+			//the calling thread doesn't need a heap of its own to free items
+			static inline void Deallocate(void* pointer)
+			{
+				auto pBucket = MemoryPoolSlab::FromPointer(pointer)->m_pBucket;
+				auto pThreadHeap = GetThreadHeapHolder().GetValidHeap();
+
+				if (pThreadHeap != nullptr && pThreadHeap->IsOwnBucket(pBucket))
+				{
+					pBucket->Deallocate(pointer);
 				}
 				else
 				{
-					spdlog::error("Memory pool: deallocation request for size [{}] with no previous allocation request registered!", size);
+					pBucket->DeallocateRemote(pointer);
+				}
+			}
+
+			//runs of items of the same bucket are freed together, the items of other heaps go to their remote free lists
+			static void DeallocateBatch(void** pItems, int count)
+			{
+				auto pThreadHeap = GetThreadHeapHolder().GetValidHeap();
+				int i = 0;
+
+				while (i < count)
+				{
+					auto pBucket = MemoryPoolSlab::FromPointer(pItems[i])->m_pBucket;
+					int runStart = i;
+
+					do
+					{
+						i++;
+					}
+					while (i < count && MemoryPoolSlab::FromPointer(pItems[i])->m_pBucket == pBucket);
+
+					if (pThreadHeap != nullptr && pThreadHeap->IsOwnBucket(pBucket))
+					{
+						pBucket->DeallocateBatch(pItems + runStart, i - runStart);
+					}
+					else
+					{
+						for (int j = runStart; j < i; j++)
+						{
+							pBucket->DeallocateRemote(pItems[j]);
+						}
+					}
+				}
+			}
+
+		private:
+
+			[[nodiscard]] inline bool IsOwnBucket(const MemoryPoolBucket* pBucket) const
+			{
+				return pBucket >= std::begin(m_Buckets) && pBucket < std::begin(m_Buckets) + m_BucketsCount;
+			}
+
+			int m_BucketsCount;
+			MemoryPoolBucket m_Buckets[MemoryPoolSettings::MaxBucketsCount];
+		};
+
+		class ThreadHeapHolder final
+		{
+		public:
+
+			ThreadHeapHolder() : m_pHeap(nullptr), m_Generation(0)
+			{
+
+			}
+
+			//the heap outlives its thread: other threads may still free its items
+			~ThreadHeapHolder()
+			{
+				MemoryPoolInternalScope scope;
+				std::lock_guard lock(m_Mutex);
+
+				if (s_pInstance != nullptr && GetValidHeap() != nullptr)
+				{
+					s_pInstance->m_AbandonedThreadHeaps.push_back(m_pHeap);
 				}
+
+				//the heap may be adopted by another thread right away, later frees from this thread are remote ones
+				m_pHeap = nullptr;
+			}
+
+			//nullptr if the thread has no heap in the current pool
+			[[nodiscard]] inline ThreadHeap* GetValidHeap() const
+			{
+				return m_Generation == s_Generation ? m_pHeap : nullptr;
 			}
+
+			ThreadHeap* m_pHeap;
+			int m_Generation;
+		};
+
+		static inline ThreadHeapHolder& GetThreadHeapHolder()
+		{
+			return MemoryPoolThreadLocal<ThreadHeapHolder>::Get();
 		}
 
-		void LogStatistics()
+		static inline ThreadHeap* GetThreadHeap()
+		{
+			auto& holder = GetThreadHeapHolder();
+			auto pHeap = holder.GetValidHeap();
+
+			if (pHeap == nullptr)
+			{
+				MemoryPoolInternalScope scope;
+				std::lock_guard lock(m_Mutex);
+
+				pHeap = s_pInstance->AcquireThreadHeap();
+
+				holder.m_pHeap = pHeap;
+				holder.m_Generation = s_Generation;
+			}
+
+			return pHeap;
+		}
+
+		//m_Mutex is expected to be locked
+		ThreadHeap* AcquireThreadHeap()
 		{
-			if (isThreadSafe)
+			if (m_AbandonedThreadHeaps.empty() == false)
 			{
-				spdlog::info("Memory Pool (Multi-threaded) requests stats:");
+				auto pHeap = m_AbandonedThreadHeaps.back();
+				m_AbandonedThreadHeaps.pop_back();
+				return pHeap;
 			}
-			else
+
+			auto pHeap = new ThreadHeap(m_HeapSettings);
+			m_ThreadHeaps.push_back(pHeap);
+			return pHeap;
+		}
+
+		//m_Mutex is expected to be locked
+		//buckets reclaim their remote frees on destruction
+		void ReleaseThreadHeaps()
+		{
+			for (auto pHeap : m_ThreadHeaps)
 			{
-				spdlog::info("Memory Pool (Single threaded) requests stats:");
+				delete pHeap;
 			}
 
-			for(auto& [key, value] : m_Requests_Total)
+			m_ThreadHeaps.clear();
+			m_AbandonedThreadHeaps.clear();
+		}
+
+
+		//-----
+		//per cpu mode: buckets are sharded by the cpu the calling thread runs on, the shards count follows the hardware threads, not the threads count
+		//the thread may migrate between picking a shard and locking it, so every shard has a mutex of its own, rarely contended
+		//a deallocation on another cpu goes to the remote free list of the owning bucket, the owning shard reclaims it on its next allocation from that bucket
+		class alignas(64) CpuShard final
+		{
+		public:
+
+			explicit CpuShard(const MemoryPoolSettings& settings) : m_Mutex(), m_BucketsCount(settings.GetBucketsCount())
 			{
-				auto requestsMax = m_Requests_Max[key];
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					m_Buckets[i].Setup(settings.GetBucketDefinition(i), false, settings.GetRetainedEmptyPagesCount(), settings.GetMaxExtraPageSize());
+					m_Buckets[i].SetOwner(GetBucketsOwner());
+				}
+			}
 
-				spdlog::info("   [{}] requests. Total: {}   Max: {}", key, value, requestsMax);
+			size_t Trim(int retainedEmptyPagesCount)
+			{
+				std::lock_guard lock(m_Mutex);
+
+				size_t result = 0;
+
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					result += m_Buckets[i].Trim(retainedEmptyPagesCount);
+				}
+
+				return result;
+			}
+
+			inline void* Allocate(int bucketIndex)
+			{
+				auto& bucket = m_Buckets[bucketIndex];
+
+				std::lock_guard lock(m_Mutex);
+
+				bucket.ReclaimRemoteItems();
+
+				return bucket.Allocate();
+			}
+
+			inline void AllocateBatch(int bucketIndex, int count, void** pOut)
+			{
+				auto& bucket = m_Buckets[bucketIndex];
+
+				std::lock_guard lock(m_Mutex);
+
+				bucket.ReclaimRemoteItems();
+				bucket.AllocateBatch(pOut, count);
+			}
+
+			static inline void Deallocate(void* pointer)
+			{
+				auto pBucket = MemoryPoolSlab::FromPointer(pointer)->m_pBucket;
+				auto pShard = GetCpuShard();
+
+				if (pShard->IsOwnBucket(pBucket))
+				{
+					std::lock_guard lock(pShard->m_Mutex);
+					pBucket->Deallocate(pointer);
+				}
+				else
+				{
+					pBucket->DeallocateRemote(pointer);
+				}
+			}
+
+			//runs of items of the same bucket are freed together, the items of other shards go to their remote free lists
+			static void DeallocateBatch(void** pItems, int count)
+			{
+				auto pShard = GetCpuShard();
+				int i = 0;
+
+				while (i < count)
+				{
+					auto pBucket = MemoryPoolSlab::FromPointer(pItems[i])->m_pBucket;
+					int runStart = i;
+
+					do
+					{
+						i++;
+					}
+					while (i < count && MemoryPoolSlab::FromPointer(pItems[i])->m_pBucket == pBucket);
+
+					if (pShard->IsOwnBucket(pBucket))
+					{
+						std::lock_guard lock(pShard->m_Mutex);
+						pBucket->DeallocateBatch(pItems + runStart, i - runStart);
+					}
+					else
+					{
+						for (int j = runStart; j < i; j++)
+						{
+							pBucket->DeallocateRemote(pItems[j]);
+						}
+					}
+				}
+			}
+
+		private:
+
+			[[nodiscard]] inline bool IsOwnBucket(const MemoryPoolBucket* pBucket) const
+			{
+				return pBucket >= std::begin(m_Buckets) && pBucket < std::begin(m_Buckets) + m_BucketsCount;
+			}
+
+			std::mutex m_Mutex;
+			int m_BucketsCount;
+			MemoryPoolBucket m_Buckets[MemoryPoolSettings::MaxBucketsCount];
+		};
+
+		static inline CpuShard* GetCpuShard()
+		{
+			auto& cpuShards = s_pInstance->m_CpuShards;
+
+			return cpuShards[GetCurrentCpu() % (int)cpuShards.size()];
+		}
+
+		//sched_getcpu reads the cpu id from the restartable sequences area glibc registers for every thread (2.35+), older versions make a vdso call
+		//without it threads are spread over the shards by their ids
+		static inline int GetCurrentCpu()
+		{
+#ifdef __linux__
+			int cpu = sched_getcpu();
+
+			if (cpu >= 0)
+			{
+				return cpu;
+			}
+#endif
+
+			static thread_local int s_ThreadShardKey = (int)(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0x7fffffff);
+
+			return s_ThreadShardKey;
+		}
+
+		//m_Mutex is expected to be locked
+		//buckets reclaim their remote frees on destruction
+		void ReleaseCpuShards()
+		{
+			for (auto pShard : m_CpuShards)
+			{
+				delete pShard;
 			}
+
+			m_CpuShards.clear();
 		}
 
 
@@ -301,14 +2125,53 @@ namespace st::memory
 		static std::thread::id s_InitThreadID;
 		static std::mutex m_Mutex;
 		static inline MemoryPool* s_pInstance = nullptr;
+		static inline int s_Generation = 0;
+		static inline std::atomic<bool> s_IsAvailable = false;
+		static inline char s_BucketsOwner = 0;
 
 		//instance data
 		int m_BucketsCount;
 		MemoryPoolBucket m_Buckets[MemoryPoolSettings::MaxBucketsCount];
 
+		bool m_UsesDefaultSizeClasses;
+		MemoryPoolSizeLookup m_SizeLookup;
+
+		bool m_IsLockFree;
+		bool m_IsThreadOwned;
+		bool m_IsPerCpu;
+		bool m_ThreadCachesEnabled;
+		int m_ThreadCacheCapacities[MemoryPoolSettings::MaxBucketsCount];
+
+		bool m_IsProvisioningEnabled;
+		std::thread m_Provisioner;
+		std::condition_variable m_ProvisioningCondition;
+		bool m_IsProvisioningRequested;
+		bool m_IsProvisionerStopping;
+
+		//bucket settings of the thread heaps and the cpu shards
+		MemoryPoolSettings m_HeapSettings;
+		std::vector<ThreadHeap*> m_ThreadHeaps;
+		std::vector<ThreadHeap*> m_AbandonedThreadHeaps;
+		std::vector<CpuShard*> m_CpuShards;
+
+		BucketStatistics m_Statistics[StatisticsCount];
+
+#ifdef MEMORY_POOL_PROFILING
+		std::mutex m_ProfilingMutex;
 		std::map<int32_t, int64_t> m_Requests_Total;
 		std::map<int32_t, int64_t> m_Requests_Current;
 		std::map<int32_t, int64_t> m_Requests_Max;
+		int64_t m_Requests_UnsizedDeallocations = 0;
+#endif
+
+#ifdef MEMORY_POOL_CHECKED
+		std::mutex m_QuarantineMutex;
+		MemoryPoolQuarantine m_Quarantine;
+#endif
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+		std::unique_ptr<MemoryPoolLeakTracker> m_pLeakTracker;
+#endif
 
 	};
 
@@ -0,0 +1,297 @@
+//
+// Created by Alexander on 28.10.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include "memory_pool.h"
+#include "spdlog/spdlog.h"
+
+namespace st::memory
+{
+	//-----
+	//a pool instance: buckets of its own, created, passed around and destroyed as a unit
+	//a subsystem that keeps its objects in an instance doesn't share pages (and the lock) with the others,
+	//and can drop all of its items at once by Reset or by destroying the instance, in O(pages)
+	//the thread safe instance guards its buckets with a mutex of its own. Sync modes, thread caches and statistics belong to the static pools
+	//requests that don't fit into the buckets go to the heap: Reset doesn't drop them, they have to be freed one by one
+	//-----
+	template<bool isThreadSafe> class MemoryPoolInstance final
+	{
+	public:
+
+		MemoryPoolInstance() : MemoryPoolInstance(GetDefaultMemoryPoolSettings(isThreadSafe))
+		{
+
+		}
+
+		explicit MemoryPoolInstance(const MemoryPoolSettings& settings) :
+				m_BucketsCount(settings.GetBucketsCount()),
+				m_Buckets(new MemoryPoolBucket[settings.GetBucketsCount()]),
+				m_SizeLookup(),
+				m_Mutex()
+		{
+			assert(m_BucketsCount > 0);
+
+			for (int i = 0; i < m_BucketsCount; i++)
+			{
+				m_Buckets[i].Setup(settings.GetBucketDefinition(i), false, settings.GetRetainedEmptyPagesCount(), settings.GetMaxExtraPageSize());
+				m_Buckets[i].SetOwner(this);
+			}
+
+			m_SizeLookup.Build(m_Buckets.get(), m_BucketsCount);
+		}
+
+		//live items are dropped together with the pages, destructors of the objects in them are not called
+		~MemoryPoolInstance()
+		{
+			Reset();
+		}
+
+		MemoryPoolInstance(const MemoryPoolInstance&) = delete;
+		MemoryPoolInstance& operator=(const MemoryPoolInstance&) = delete;
+
+		[[nodiscard]] void* Allocate(size_t size)
+		{
+			return DoAllocate(size, m_SizeLookup.GetBucketIndex(size), DefaultAlignment);
+		}
+
+		//the item comes from the smallest bucket that fits the size and is aligned enough
+		//the same alignment is expected by Deallocate
+		[[nodiscard]] void* Allocate(size_t size, size_t alignment)
+		{
+			return DoAllocate(size, m_SizeLookup.GetBucketIndex(size, alignment), alignment);
+		}
+
+		template<typename T> [[nodiscard]] T* Allocate()
+		{
+			return reinterpret_cast<T*>(Allocate(sizeof(T), alignof(T)));
+		}
+
+		void Deallocate(void* pointer, size_t size)
+		{
+			DoDeallocate(pointer, m_SizeLookup.GetBucketIndex(size));
+		}
+
+		void Deallocate(void* pointer, size_t size, size_t alignment)
+		{
+			DoDeallocate(pointer, m_SizeLookup.GetBucketIndex(size, alignment));
+		}
+
+		template<typename T> void Deallocate(T* pointer)
+		{
+			Deallocate(pointer, sizeof(T), alignof(T));
+		}
+
+		//size-free deallocation: the bucket is found through the slab header, anything else is a heap allocation
+		void Deallocate(void* pointer)
+		{
+			if (pointer == nullptr)
+			{
+				return;
+			}
+
+			if (MemoryPoolPageMap::Contains(pointer) == false)
+			{
+				StaticPool::DeallocateOversized(pointer);
+				return;
+			}
+
+			auto pBucket = MemoryPoolSlab::FromPointer(pointer)->m_pBucket;
+			auto pOwner = pBucket->GetOwner();
+
+			//foreign items must not get into the buckets of this instance (nor into their owner's ones under the lock of this instance)
+			if (pOwner != this)
+			{
+				if (pOwner == MemoryPool<true>::GetBucketsOwner() || pOwner == MemoryPool<false>::GetBucketsOwner())
+				{
+					StaticPool::Deallocate(pointer);
+					return;
+				}
+
+				spdlog::error("Memory pool instance: size-free deallocation of an item that belongs to another instance, ignored. Pointer: {}", pointer);
+				return;
+			}
+
+			DoDeallocate(pointer, pBucket);
+		}
+
+		//the instance a pooled item belongs to, nullptr for heap allocations and the items of the static pools
+		//the item is expected to come from an instance of the same kind (thread safe or not)
+		[[nodiscard]] static MemoryPoolInstance* FromPointer(void* pointer)
+		{
+			if (pointer == nullptr || MemoryPoolPageMap::Contains(pointer) == false)
+			{
+				return nullptr;
+			}
+
+			auto pOwner = MemoryPoolSlab::FromPointer(pointer)->m_pBucket->GetOwner();
+
+			if (pOwner == MemoryPool<true>::GetBucketsOwner() || pOwner == MemoryPool<false>::GetBucketsOwner())
+			{
+				return nullptr;
+			}
+
+			return static_cast<MemoryPoolInstance*>(pOwner);
+		}
+
+		//deallocation without the instance at hand: pooled items go back to the instance or the static pool they belong to, anything else to the heap
+		static void DeallocateToOwner(void* pointer)
+		{
+			auto pInstance = FromPointer(pointer);
+
+			if (pInstance != nullptr)
+			{
+				pInstance->Deallocate(pointer);
+			}
+			else if (pointer != nullptr && MemoryPoolPageMap::Contains(pointer))
+			{
+				StaticPool::Deallocate(pointer);
+			}
+			else
+			{
+				StaticPool::DeallocateOversized(pointer);
+			}
+		}
+
+		//drops every item at once: all the pages go back to the system, the next allocations start with new pages
+		//destructors of the objects in them are not called. Returns the amount of bytes freed
+		size_t Reset()
+		{
+			auto reset = [this]()
+			{
+				size_t result = 0;
+
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					result += m_Buckets[i].Reset();
+				}
+
+				return result;
+			};
+
+			if constexpr(isThreadSafe)
+			{
+				std::lock_guard lock(m_Mutex);
+				return reset();
+			}
+			else
+			{
+				return reset();
+			}
+		}
+
+		//see MemoryPool::Trim
+		size_t Trim(int retainedEmptyPagesCount = 0)
+		{
+			auto trim = [this, retainedEmptyPagesCount]()
+			{
+				size_t result = 0;
+
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					result += m_Buckets[i].Trim(retainedEmptyPagesCount);
+				}
+
+				return result;
+			};
+
+			if constexpr(isThreadSafe)
+			{
+				std::lock_guard lock(m_Mutex);
+				return trim();
+			}
+			else
+			{
+				return trim();
+			}
+		}
+
+		//items handed out by the buckets and not freed yet
+		[[nodiscard]] int GetItemsCount()
+		{
+			auto count = [this]()
+			{
+				int result = 0;
+
+				for (int i = 0; i < m_BucketsCount; i++)
+				{
+					result += m_Buckets[i].GetTotalItemsCount() - m_Buckets[i].GetFreeItemsCount();
+				}
+
+				return result;
+			};
+
+			if constexpr(isThreadSafe)
+			{
+				std::lock_guard lock(m_Mutex);
+				return count();
+			}
+			else
+			{
+				return count();
+			}
+		}
+
+	private:
+
+		using StaticPool = MemoryPool<isThreadSafe>;
+
+		static constexpr int InvalidIndex = MemoryPoolSizeLookup::InvalidIndex;
+		static constexpr size_t DefaultAlignment = alignof(std::max_align_t);
+
+		inline void* DoAllocate(size_t size, int bucketIndex, size_t alignment)
+		{
+			if (bucketIndex == InvalidIndex)
+			{
+				return StaticPool::AllocateOversized(size, alignment);
+			}
+
+			if constexpr(isThreadSafe)
+			{
+				std::lock_guard lock(m_Mutex);
+				return m_Buckets[bucketIndex].Allocate();
+			}
+			else
+			{
+				return m_Buckets[bucketIndex].Allocate();
+			}
+		}
+
+		inline void DoDeallocate(void* pointer, int bucketIndex)
+		{
+			if (bucketIndex == InvalidIndex)
+			{
+				StaticPool::DeallocateOversized(pointer);
+				return;
+			}
+
+			DoDeallocate(pointer, &m_Buckets[bucketIndex]);
+		}
+
+		inline void DoDeallocate(void* pointer, MemoryPoolBucket* pBucket)
+		{
+			if constexpr(isThreadSafe)
+			{
+				std::lock_guard lock(m_Mutex);
+				pBucket->Deallocate(pointer);
+			}
+			else
+			{
+				pBucket->Deallocate(pointer);
+			}
+		}
+
+		int m_BucketsCount;
+		std::unique_ptr<MemoryPoolBucket[]> m_Buckets;
+		MemoryPoolSizeLookup m_SizeLookup;
+		std::mutex m_Mutex;
+	};
+
+	using MemoryPoolInstanceSingleThreaded [[maybe_unused]] = MemoryPoolInstance<false>;
+	using MemoryPoolInstanceMultiThreaded  [[maybe_unused]] = MemoryPoolInstance<true>;
+}
@@ -5,7 +5,10 @@
 #pragma once
 
 #include <cstddef>
+#include <new>
+#include <type_traits>
 #include "memory_pool.h"
+#include "memory_pool_instance.h"
 
 namespace st::memory
 {
@@ -23,6 +26,43 @@ namespace st::memory
 			MemoryPool<isThreadSafe>::Deallocate(p, size);
 		}
 
+		//over-aligned derived classes
+		static void* operator new(std::size_t size, std::align_val_t alignment)
+		{
+			return MemoryPool<isThreadSafe>::Allocate(size, static_cast<std::size_t>(alignment));
+		}
+
+		static void operator delete(void* p, std::size_t size, std::align_val_t alignment)
+		{
+			MemoryPool<isThreadSafe>::Deallocate(p, size, static_cast<std::size_t>(alignment));
+		}
+
+		//count objects of type T with a single batch allocation, every one of them constructed from args
+		//T is expected to be the exact type of the objects, the batch is freed with sizeof(T) by DeleteBatch
+		template<typename T, typename... Args> static void NewBatch(int count, T** pOut, const Args&... args)
+		{
+			static_assert(std::is_base_of_v<Poolable, T>);
+
+			MemoryPool<isThreadSafe>::AllocateBatch(count, pOut);
+
+			for (int i = 0; i < count; i++)
+			{
+				pOut[i] = ::new (static_cast<void*>(pOut[i])) T(args...);
+			}
+		}
+
+		template<typename T> static void DeleteBatch(T** pObjects, int count)
+		{
+			static_assert(std::is_base_of_v<Poolable, T>);
+
+			for (int i = 0; i < count; i++)
+			{
+				pObjects[i]->~T();
+			}
+
+			MemoryPool<isThreadSafe>::DeallocateBatch(pObjects, count);
+		}
+
 	protected:
 
 		//forces any derived classes to have virtual destructor
@@ -32,4 +72,49 @@ namespace st::memory
 	private:
 
 	};
+
+
+	//objects kept in a pool instance: created by new (instance) T(args), deleted by a plain delete
+	//the instance is found from the object through its slab, objects too large for the buckets are heap allocations
+	//objects still alive when their instance is reset or destroyed are dropped without their destructors being called
+	template<bool isThreadSafe> class InstancePoolable
+	{
+	public:
+
+		static void* operator new(std::size_t size, MemoryPoolInstance<isThreadSafe>& instance)
+		{
+			return instance.Allocate(size);
+		}
+
+		static void operator delete(void* p, std::size_t)
+		{
+			MemoryPoolInstance<isThreadSafe>::DeallocateToOwner(p);
+		}
+
+		//over-aligned derived classes
+		static void* operator new(std::size_t size, std::align_val_t alignment, MemoryPoolInstance<isThreadSafe>& instance)
+		{
+			return instance.Allocate(size, static_cast<std::size_t>(alignment));
+		}
+
+		static void operator delete(void* p, std::size_t, std::align_val_t)
+		{
+			MemoryPoolInstance<isThreadSafe>::DeallocateToOwner(p);
+		}
+
+		//called if a constructor throws
+		static void operator delete(void* p, MemoryPoolInstance<isThreadSafe>& instance)
+		{
+			instance.Deallocate(p);
+		}
+
+		static void operator delete(void* p, std::align_val_t, MemoryPoolInstance<isThreadSafe>& instance)
+		{
+			instance.Deallocate(p);
+		}
+
+	protected:
+
+		virtual ~InstancePoolable() = default;
+	};
 }
\ No newline at end of file
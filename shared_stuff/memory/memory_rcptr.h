@@ -28,6 +28,8 @@ namespace st::memory
 {
 	template<typename T> class rcptr;
 	template<typename T> class wptr;
+	template<bool isThreadSafe> class MemoryPoolInstance;
+	template<typename T> class ObjectPool;
 
 	template<typename T> class rcptr final
 	{
@@ -36,9 +38,11 @@ namespace st::memory
 		//FRIENDS
 		template<typename U> friend class rcptr;
 		template<typename U> friend class wptr;
+		template<typename U> friend class ObjectPool;
 
 		template<typename TObjectType, typename ... Args> friend rcptr<TObjectType> CreateRefCountedPointer(Args&& ... args);
 		template<typename TPointerType, typename TObjectType, typename ... Args> friend rcptr<TPointerType> CreateRefCountedPointer(Args&& ... args);
+		template<typename TObjectType, bool isThreadSafe, typename ... Args> friend rcptr<TObjectType> CreateRefCountedPointerIn(MemoryPoolInstance<isThreadSafe>& instance, Args&& ... args);
 
 		template<typename TObjectType> rcptr<TObjectType> friend GetRefCountedPointer(TObjectType* pRefCountedObject);
 		template<typename TPointerType, typename TObjectType> friend rcptr<TPointerType> GetRefCountedPointer(TObjectType* pRefCountedObject);
@@ -478,6 +482,14 @@ namespace st::memory
 	}
 
 
+	//the object is created in a pool instance, TObjectType is expected to be InstancePoolable
+	template<typename TObjectType, bool isThreadSafe, typename ... Args> rcptr<TObjectType> CreateRefCountedPointerIn(MemoryPoolInstance<isThreadSafe>& instance, Args&& ... args)
+	{
+		TObjectType* p = new (instance) TObjectType(std::forward<Args>(args)...);
+		return rcptr<TObjectType>(p, true);
+	}
+
+
 	template<typename TObjectType> rcptr<TObjectType> GetRefCountedPointer(TObjectType* pRefCountedObject)
 	{
 		assert(pRefCountedObject != nullptr);
@@ -15,6 +15,21 @@ namespace st::memory
 	}
 
 
+	void ReferenceCounted::OnNoOwnersLeft()
+	{
+		delete this;
+	}
+
+
+	void ReferenceCounted::ResetReferenceCounts()
+	{
+		assert(m_ReferenceCount == 0);
+		assert(m_WeakReferenceCount == 0);
+
+		m_ReferenceCount = 1;
+	}
+
+
 	void ReferenceCounted::ReferenceCountIncrease()
 	{
 		assert(m_ReferenceCount > 0);
@@ -41,7 +56,7 @@ namespace st::memory
 
 			if (m_WeakReferenceCount == 0)
 			{
-				delete this;
+				OnNoOwnersLeft();
 			}
 		}
 	}
@@ -67,7 +82,7 @@ namespace st::memory
 		{
 			if (m_ReferenceCount == 0)
 			{
-				delete this;
+				OnNoOwnersLeft();
 			}
 		}
 	}
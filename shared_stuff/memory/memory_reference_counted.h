@@ -28,6 +28,12 @@ namespace st::memory
 
 		virtual void OnNoReferenceCountingOwnersLeft() {};
 
+		//called when neither strong nor weak owners are left: deletes the object, recycling classes (see PooledReferenceCounted) override it
+		virtual void OnNoOwnersLeft();
+
+		//a recycled object gets the counts it had after the construction, before it is shared again
+		void ResetReferenceCounts();
+
 	private:
 
 		[[nodiscard]] inline int GetReferenceCount() const {return m_ReferenceCount;}
@@ -0,0 +1,130 @@
+//
+// Created by Alexander on 01.11.2021.
+//
+
+#pragma once
+
+#include <memory_resource>
+#include "memory_pool.h"
+#include "memory_pool_instance.h"
+#include "memory_arena.h"
+
+namespace st::memory
+{
+	//-----
+	//std::pmr::memory_resource adapters: pmr containers get pooled memory without template changes
+	//sized deallocation goes straight to the bucket of the size and alignment, as with the typed allocators
+	//-----
+
+
+	//over the static pool, which is expected to be initialized. All the resources of a pool are interchangeable, Get() gives a shared one
+	template<bool isThreadSafe> class PoolMemoryResource final : public std::pmr::memory_resource
+	{
+	public:
+
+		[[nodiscard]] static PoolMemoryResource* Get()
+		{
+			static PoolMemoryResource resource;
+			return &resource;
+		}
+
+	private:
+
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			return MemoryPool<isThreadSafe>::Allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override
+		{
+			MemoryPool<isThreadSafe>::Deallocate(p, bytes, alignment);
+		}
+
+		[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other || dynamic_cast<const PoolMemoryResource*>(&other) != nullptr;
+		}
+	};
+
+	using PoolMemoryResourceSingleThreaded [[maybe_unused]] = PoolMemoryResource<false>;
+	using PoolMemoryResourceMultiThreaded  [[maybe_unused]] = PoolMemoryResource<true>;
+
+
+	//over a pool instance, resources of the same instance are interchangeable
+	template<bool isThreadSafe> class InstanceMemoryResource final : public std::pmr::memory_resource
+	{
+	public:
+
+		explicit InstanceMemoryResource(MemoryPoolInstance<isThreadSafe>& instance) noexcept : m_pInstance(&instance)
+		{
+
+		}
+
+		[[nodiscard]] MemoryPoolInstance<isThreadSafe>& GetInstance() const
+		{
+			return *m_pInstance;
+		}
+
+	private:
+
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			return m_pInstance->Allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override
+		{
+			m_pInstance->Deallocate(p, bytes, alignment);
+		}
+
+		[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			auto pOther = dynamic_cast<const InstanceMemoryResource*>(&other);
+
+			return pOther != nullptr && pOther->m_pInstance == m_pInstance;
+		}
+
+		MemoryPoolInstance<isThreadSafe>* m_pInstance;
+	};
+
+	using InstanceMemoryResourceSingleThreaded [[maybe_unused]] = InstanceMemoryResource<false>;
+	using InstanceMemoryResourceMultiThreaded  [[maybe_unused]] = InstanceMemoryResource<true>;
+
+
+	//over an arena: deallocation is a no-op, the memory comes back with the arena reset. Not thread safe, as the arena
+	class ArenaMemoryResource final : public std::pmr::memory_resource
+	{
+	public:
+
+		explicit ArenaMemoryResource(MemoryArena& arena) noexcept : m_pArena(&arena)
+		{
+
+		}
+
+		[[nodiscard]] MemoryArena& GetArena() const
+		{
+			return *m_pArena;
+		}
+
+	private:
+
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			return m_pArena->Allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void*, size_t, size_t) override
+		{
+
+		}
+
+		[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			auto pOther = dynamic_cast<const ArenaMemoryResource*>(&other);
+
+			return pOther != nullptr && pOther->m_pArena == m_pArena;
+		}
+
+		MemoryArena* m_pArena;
+	};
+}
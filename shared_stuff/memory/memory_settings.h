@@ -12,4 +12,38 @@
 
 #define SMARTPTR_THREAD_VALIDATION
 
-#endif
\ No newline at end of file
+#endif
+
+//-----
+//MEMORY POOL
+//-----
+
+//per bucket requests statistics (total, current and max), MEMORY_POOL_NO_STATISTICS turns them off
+#ifndef MEMORY_POOL_NO_STATISTICS
+
+#define MEMORY_POOL_STATISTICS
+
+#endif
+
+//profiling mode: exact requests histogram per requested size, every request goes through a mutex
+//#define MEMORY_POOL_PROFILING
+
+//checked mode: O(1) validation of every free (double and invalid frees), freed items poisoning and quarantine,
+//canaries past the requested sizes. Failures are logged and counted, see MemoryPoolChecks
+//#define MEMORY_POOL_CHECKED
+
+//leak tracking mode: sampled live allocations with their call stacks, reported by call site on Release and on demand
+//see MemoryPoolLeakTracker and MemoryPoolSettings::SetLeakTrackingSampleInterval
+//#define MEMORY_POOL_LEAK_TRACKING
+
+
+//-----
+//MEMORY STACK
+//-----
+
+//a guard word after every stack allocation, checked when the stack is freed back to a marker
+#ifdef DEBUG
+
+#define MEMORY_STACK_CHECK_OVERFLOW
+
+#endif
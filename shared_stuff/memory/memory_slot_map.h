@@ -0,0 +1,232 @@
+//
+// Created by Alexander on 03.11.2021.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <utility>
+#include <vector>
+#include "memory_allocator.h"
+
+namespace st::memory
+{
+	//-----
+	//32 bits handle of a SlotMap value: slot index and slot generation
+	//a handle is stale once its value is erased: the slot generation moves on, so the check is a compare, no object is touched
+	//the default (zero) handle is never valid
+	//-----
+	struct SlotMapHandle
+	{
+		uint32_t m_Value = 0;
+
+		bool operator==(const SlotMapHandle& other) const { return m_Value == other.m_Value; }
+		bool operator!=(const SlotMapHandle& other) const { return m_Value != other.m_Value; }
+	};
+
+
+	//-----
+	//values are packed densely (erasing moves the last value into the gap) and addressed through generational handles
+	//insert, erase and lookup are O(1), iteration walks the dense values. The storage comes from the multithreaded memory pool
+	//a slot is retired when its generation runs out, so stale handles never come back to life: a retired slot costs 8 bytes
+	//and MaxSize limits the slots ever created, which takes billions of erases
+	//not thread safe. Pointers and references to values are invalidated by inserts and erases, handles are not
+	//-----
+	template<typename T> class SlotMap final
+	{
+	public:
+
+		static constexpr int IndexBits = 20;
+		static constexpr int GenerationBits = 32 - IndexBits;
+		static constexpr uint32_t MaxSize = (1u << IndexBits) - 1;
+
+		template<typename ... Args> SlotMapHandle Emplace(Args&& ... args)
+		{
+			uint32_t slotIndex;
+
+			if (m_FirstFreeSlot != NoSlot)
+			{
+				slotIndex = m_FirstFreeSlot;
+				m_FirstFreeSlot = m_Slots[slotIndex].m_DenseIndex;
+			}
+			else
+			{
+				assert(m_Slots.size() < MaxSize);
+
+				slotIndex = (uint32_t)m_Slots.size();
+				m_Slots.push_back({0, 1});
+			}
+
+			auto& slot = m_Slots[slotIndex];
+			slot.m_DenseIndex = (uint32_t)m_Values.size();
+
+			m_Values.emplace_back(std::forward<Args>(args)...);
+			m_DenseSlots.push_back(slotIndex);
+
+			return MakeHandle(slotIndex, slot.m_Generation);
+		}
+
+		SlotMapHandle Insert(const T& value)
+		{
+			return Emplace(value);
+		}
+
+		SlotMapHandle Insert(T&& value)
+		{
+			return Emplace(std::move(value));
+		}
+
+		//false for stale handles
+		bool Erase(SlotMapHandle handle)
+		{
+			if (Contains(handle) == false)
+			{
+				return false;
+			}
+
+			uint32_t slotIndex = GetSlotIndex(handle);
+			auto& slot = m_Slots[slotIndex];
+
+			//the last value fills the gap
+			uint32_t denseIndex = slot.m_DenseIndex;
+			uint32_t lastDenseIndex = (uint32_t)m_Values.size() - 1;
+
+			if (denseIndex != lastDenseIndex)
+			{
+				m_Values[denseIndex] = std::move(m_Values[lastDenseIndex]);
+				m_DenseSlots[denseIndex] = m_DenseSlots[lastDenseIndex];
+				m_Slots[m_DenseSlots[denseIndex]].m_DenseIndex = denseIndex;
+			}
+
+			m_Values.pop_back();
+			m_DenseSlots.pop_back();
+
+			//the last generation retires the slot: it's never reused, the handles of any generation stay stale
+			if (slot.m_Generation == GenerationMask)
+			{
+				slot.m_Generation = RetiredGeneration;
+				slot.m_DenseIndex = NoSlot;
+
+				return true;
+			}
+
+			slot.m_Generation++;
+
+			slot.m_DenseIndex = m_FirstFreeSlot;
+			m_FirstFreeSlot = slotIndex;
+
+			return true;
+		}
+
+		//the slot has to be live too: the dense value it points to points back to it
+		[[nodiscard]] inline bool Contains(SlotMapHandle handle) const
+		{
+			uint32_t slotIndex = GetSlotIndex(handle);
+
+			if (slotIndex >= m_Slots.size())
+			{
+				return false;
+			}
+
+			auto& slot = m_Slots[slotIndex];
+
+			return slot.m_Generation == GetGeneration(handle) && slot.m_DenseIndex < m_DenseSlots.size() && m_DenseSlots[slot.m_DenseIndex] == slotIndex;
+		}
+
+		//nullptr for stale handles
+		[[nodiscard]] inline T* Get(SlotMapHandle handle)
+		{
+			if (Contains(handle) == false)
+			{
+				return nullptr;
+			}
+
+			return &m_Values[m_Slots[GetSlotIndex(handle)].m_DenseIndex];
+		}
+
+		[[nodiscard]] inline const T* Get(SlotMapHandle handle) const
+		{
+			return const_cast<SlotMap*>(this)->Get(handle);
+		}
+
+		//handle of the value at a dense index, for iterating values together with their handles
+		[[nodiscard]] SlotMapHandle GetHandle(int denseIndex) const
+		{
+			assert(denseIndex >= 0 && denseIndex < GetSize());
+
+			uint32_t slotIndex = m_DenseSlots[denseIndex];
+
+			return MakeHandle(slotIndex, m_Slots[slotIndex].m_Generation);
+		}
+
+		//all the handles become stale
+		void Clear()
+		{
+			while (m_Values.empty() == false)
+			{
+				Erase(GetHandle(GetSize() - 1));
+			}
+		}
+
+		void Reserve(int capacity)
+		{
+			m_Values.reserve(capacity);
+			m_DenseSlots.reserve(capacity);
+			m_Slots.reserve(capacity);
+		}
+
+		[[nodiscard]] int GetSize() const
+		{
+			return (int)m_Values.size();
+		}
+
+		[[nodiscard]] bool IsEmpty() const
+		{
+			return m_Values.empty();
+		}
+
+		//dense values, in no particular order
+		T* begin() { return m_Values.data(); }
+		T* end() { return m_Values.data() + m_Values.size(); }
+		const T* begin() const { return m_Values.data(); }
+		const T* end() const { return m_Values.data() + m_Values.size(); }
+
+	private:
+
+		static constexpr uint32_t NoSlot = ~0u;
+		static constexpr uint32_t IndexMask = MaxSize;
+		static constexpr uint32_t GenerationMask = (1u << GenerationBits) - 1;
+
+		//handles start with generation 1, so the zero handle is never valid
+		static constexpr uint32_t RetiredGeneration = 0;
+
+		//a free slot keeps the next free slot index in place of the dense index, a retired one NoSlot
+		struct Slot
+		{
+			uint32_t m_DenseIndex;
+			uint32_t m_Generation;
+		};
+
+		static inline SlotMapHandle MakeHandle(uint32_t slotIndex, uint32_t generation)
+		{
+			return {(generation << IndexBits) | slotIndex};
+		}
+
+		static inline uint32_t GetSlotIndex(SlotMapHandle handle)
+		{
+			return handle.m_Value & IndexMask;
+		}
+
+		static inline uint32_t GetGeneration(SlotMapHandle handle)
+		{
+			return handle.m_Value >> IndexBits;
+		}
+
+		std::vector<T, AllocatorMultiThreaded<T>> m_Values;
+		std::vector<uint32_t, AllocatorMultiThreaded<uint32_t>> m_DenseSlots;
+		std::vector<Slot, AllocatorMultiThreaded<Slot>> m_Slots;
+
+		uint32_t m_FirstFreeSlot = NoSlot;
+	};
+}
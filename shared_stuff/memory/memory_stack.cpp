@@ -0,0 +1,123 @@
+//
+// Created by Alexander on 30.10.2021.
+//
+
+#include <cstdlib>
+#include "memory_stack.h"
+#include "spdlog/spdlog.h"
+
+namespace st::memory
+{
+	std::atomic<size_t> MemoryStack::s_ThreadStackCapacity = DefaultCapacity;
+
+
+	//the buffer is a plain heap allocation, so the global new replacement (and the pool) are not involved
+	MemoryStack::MemoryStack(size_t capacity) :
+			m_pBuffer(static_cast<char*>(std::malloc(capacity))),
+			m_Capacity(capacity),
+			m_Top(0),
+			m_MaxUsedSize(0)
+	{
+		assert(m_Capacity > 0);
+		assert(m_pBuffer != nullptr);
+	}
+
+
+	MemoryStack::~MemoryStack()
+	{
+		if (m_Top != 0)
+		{
+			spdlog::warn("Memory stack: destroyed with {} bytes not freed", m_Top);
+		}
+
+		std::free(m_pBuffer);
+	}
+
+
+	size_t MemoryStack::GetCapacity() const
+	{
+		return m_Capacity;
+	}
+
+
+	size_t MemoryStack::GetUsedSize() const
+	{
+		return m_Top;
+	}
+
+
+	size_t MemoryStack::GetMaxUsedSize() const
+	{
+		return m_MaxUsedSize;
+	}
+
+
+	MemoryStack& MemoryStack::GetThreadStack()
+	{
+		thread_local MemoryStack threadStack(s_ThreadStackCapacity.load(std::memory_order_relaxed));
+
+		return threadStack;
+	}
+
+
+	void MemoryStack::SetThreadStackCapacity(size_t capacity)
+	{
+		assert(capacity > 0);
+
+		s_ThreadStackCapacity.store(capacity, std::memory_order_relaxed);
+	}
+
+
+	size_t MemoryStack::GetThreadStackCapacity()
+	{
+		return s_ThreadStackCapacity.load(std::memory_order_relaxed);
+	}
+
+
+#ifdef MEMORY_STACK_CHECK_OVERFLOW
+	void MemoryStack::CheckGuards(Marker marker) const
+	{
+		size_t top = m_Top;
+
+		while (top > marker)
+		{
+			Record record{};
+
+			if (top >= sizeof(Record) + GuardSize)
+			{
+				std::memcpy(&record, m_pBuffer + top - sizeof(Record), sizeof(Record));
+			}
+
+			//a long enough overflow overwrites the record after the guard too, the walk can't go on then
+			//the guard of a valid record is below it, and the previous top is below the guard
+			if (top < sizeof(Record) + GuardSize || record.m_GuardOffset > top - sizeof(Record) - GuardSize || record.m_PreviousTop > record.m_GuardOffset)
+			{
+				spdlog::error("Memory stack: write past the end of an allocation, the record below offset {} is overwritten", top);
+				assert(false);
+
+				return;
+			}
+
+			if (std::memcmp(m_pBuffer + record.m_GuardOffset, &GuardValue, GuardSize) != 0)
+			{
+				spdlog::error("Memory stack: write past the end of an allocation, guard at offset {} is overwritten", record.m_GuardOffset);
+				assert(false);
+			}
+
+			top = record.m_PreviousTop;
+		}
+
+		//markers are taken between allocations, anything else is a marker of another stack or of a freed part of this one
+		assert(top == marker);
+	}
+#endif
+
+
+	void* MemoryStack::OnExhausted(size_t size) const
+	{
+		spdlog::error("Memory stack: exhausted, {} bytes requested with {} of {} bytes used", size, m_Top, m_Capacity);
+
+		return nullptr;
+	}
+
+}
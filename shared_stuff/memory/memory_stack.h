@@ -0,0 +1,170 @@
+//
+// Created by Alexander on 30.10.2021.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <atomic>
+#include <algorithm>
+#include "memory_settings.h"
+
+namespace st::memory
+{
+	//-----
+	//LIFO stack allocator for nested temporaries: a fixed buffer with a top offset, allocations bump the top,
+	//FreeToMarker brings it back to a marker taken earlier, freeing everything allocated after it.
+	//doesn't touch the pool buckets and doesn't lock, not thread safe: threads use their own stacks (GetThreadStack)
+	//MEMORY_STACK_CHECK_OVERFLOW puts a guard word after every allocation and checks the guards when the stack is freed
+	//-----
+	class MemoryStack final
+	{
+	public:
+
+		using Marker = size_t;
+
+		static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+		explicit MemoryStack(size_t capacity = DefaultCapacity);
+		~MemoryStack();
+
+		MemoryStack(const MemoryStack&) = delete;
+		MemoryStack& operator=(const MemoryStack&) = delete;
+
+		//nullptr (and an error) if the stack is exhausted
+		[[nodiscard]] inline void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+		{
+			assert((alignment & (alignment - 1)) == 0);
+
+			auto base = reinterpret_cast<uintptr_t>(m_pBuffer);
+			auto start = (base + m_Top + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			size_t end = start - base + size;
+
+#ifdef MEMORY_STACK_CHECK_OVERFLOW
+			size_t recordOffset = (end + GuardSize + alignof(Record) - 1) & ~(alignof(Record) - 1);
+			size_t top = recordOffset + sizeof(Record);
+#else
+			size_t top = end;
+#endif
+
+			if (top > m_Capacity || end < size)
+			{
+				return OnExhausted(size);
+			}
+
+#ifdef MEMORY_STACK_CHECK_OVERFLOW
+			Record record{m_Top, end};
+			std::memcpy(m_pBuffer + end, &GuardValue, GuardSize);
+			std::memcpy(m_pBuffer + recordOffset, &record, sizeof(Record));
+#endif
+
+			m_Top = top;
+			m_MaxUsedSize = std::max(m_MaxUsedSize, m_Top);
+
+			return reinterpret_cast<void*>(start);
+		}
+
+		template<typename T> [[nodiscard]] T* Allocate(int count = 1)
+		{
+			return reinterpret_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		[[nodiscard]] inline Marker GetMarker() const
+		{
+			return m_Top;
+		}
+
+		//frees everything allocated after the marker was taken. Markers taken after it become invalid
+		inline void FreeToMarker(Marker marker)
+		{
+			assert(marker <= m_Top);
+
+#ifdef MEMORY_STACK_CHECK_OVERFLOW
+			CheckGuards(marker);
+#endif
+
+			m_Top = marker;
+		}
+
+		[[nodiscard]] size_t GetCapacity() const;
+		[[nodiscard]] size_t GetUsedSize() const;
+
+		//the highest top so far, for sizing the capacity
+		[[nodiscard]] size_t GetMaxUsedSize() const;
+
+		//the calling thread's stack, created on the first use with the thread stack capacity
+		static MemoryStack& GetThreadStack();
+
+		//capacity of the thread stacks created after the call
+		static void SetThreadStackCapacity(size_t capacity);
+		[[nodiscard]] static size_t GetThreadStackCapacity();
+
+	private:
+
+#ifdef MEMORY_STACK_CHECK_OVERFLOW
+		//placed after the guard of every allocation, the guards are walked back from the top
+		struct Record
+		{
+			size_t m_PreviousTop;
+			size_t m_GuardOffset;
+		};
+
+		static constexpr uint64_t GuardValue = 0xFDFDFDFDFDFDFDFDull;
+		static constexpr size_t GuardSize = sizeof(GuardValue);
+
+		void CheckGuards(Marker marker) const;
+#endif
+
+		void* OnExhausted(size_t size) const;
+
+		char* m_pBuffer;
+		size_t m_Capacity;
+		size_t m_Top;
+		size_t m_MaxUsedSize;
+
+		static std::atomic<size_t> s_ThreadStackCapacity;
+	};
+
+
+	//frees the stack back to the marker taken on construction
+	class MemoryStackScope final
+	{
+	public:
+
+		explicit MemoryStackScope(MemoryStack& stack = MemoryStack::GetThreadStack()) : m_Stack(stack), m_Marker(stack.GetMarker())
+		{
+
+		}
+
+		~MemoryStackScope()
+		{
+			m_Stack.FreeToMarker(m_Marker);
+		}
+
+		MemoryStackScope(const MemoryStackScope&) = delete;
+		MemoryStackScope& operator=(const MemoryStackScope&) = delete;
+
+		[[nodiscard]] inline void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+		{
+			return m_Stack.Allocate(size, alignment);
+		}
+
+		template<typename T> [[nodiscard]] T* Allocate(int count = 1)
+		{
+			return m_Stack.Allocate<T>(count);
+		}
+
+		[[nodiscard]] MemoryStack& GetStack() const
+		{
+			return m_Stack;
+		}
+
+	private:
+
+		MemoryStack& m_Stack;
+		const MemoryStack::Marker m_Marker;
+	};
+}
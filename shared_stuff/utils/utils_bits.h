@@ -0,0 +1,29 @@
+//
+// Created by Alexander on 20.10.2021.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace st::utils
+{
+	//index of the highest set bit, the value must not be 0
+	inline int GetHighestBitIndex(uint64_t value)
+	{
+		assert(value != 0);
+
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+}
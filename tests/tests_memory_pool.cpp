@@ -0,0 +1,2170 @@
+//
+// Created by Alexander on 18.10.2021.
+//
+
+#include "catch.hpp"
+#include "memory_pool.h"
+#include "memory_allocator.h"
+#include "memory_poolable.h"
+#include "memory_pool_instance.h"
+#include "memory_arena.h"
+#include "memory_stack.h"
+#include "memory_frame_allocator.h"
+#include "memory_resource.h"
+#include "memory_object_pool.h"
+#include "memory_slot_map.h"
+#include "memory_rcptr.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+
+TEST_CASE("memory pool thread caches")
+{
+	st::memory::MemoryPoolMultiThreaded::Init();
+
+	const int ThreadsCount = 4;
+	const int ItemsCount = 1000;
+
+	std::vector<std::thread> threads;
+	std::vector<std::vector<int*>> itemsPerThread(ThreadsCount);
+
+	//allocating on worker threads
+	for (int i = 0; i < ThreadsCount; i++)
+	{
+		threads.emplace_back([&items = itemsPerThread[i], i, ItemsCount]()
+		{
+			for (int j = 0; j < ItemsCount; j++)
+			{
+				auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int>();
+				*pItem = i * ItemsCount + j;
+				items.push_back(pItem);
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	threads.clear();
+
+	//checking and deallocating on other threads
+	std::atomic<int> invalidValuesCount = 0;
+
+	for (int i = 0; i < ThreadsCount; i++)
+	{
+		threads.emplace_back([&items = itemsPerThread[(i + 1) % ThreadsCount], &invalidValuesCount, i, ItemsCount]()
+		{
+			int owner = (i + 1) % ThreadsCount;
+
+			for (int j = 0; j < ItemsCount; j++)
+			{
+				if (*items[j] != owner * ItemsCount + j)
+				{
+					invalidValuesCount++;
+				}
+
+				st::memory::MemoryPoolMultiThreaded::Deallocate(items[j]);
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE( invalidValuesCount == 0 );
+
+	//the calling thread's cache is flushed on release
+	auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int>();
+	st::memory::MemoryPoolMultiThreaded::Deallocate(pItem);
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+TEST_CASE("memory pool bucket free lists")
+{
+	st::memory::MemoryPoolSingleThreaded::Init();
+
+	const int ItemsCount = 100;
+
+	std::vector<int64_t*> items;
+
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		items.push_back(st::memory::MemoryPoolSingleThreaded::Allocate<int64_t>());
+	}
+
+	//fresh pages are handed out in address order
+	for (int i = 1; i < ItemsCount; i++)
+	{
+		REQUIRE( reinterpret_cast<char*>(items[i]) - reinterpret_cast<char*>(items[i - 1]) == sizeof(int64_t) );
+	}
+
+	//freed items are reused first
+	auto pFreed = items[ItemsCount / 2];
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pFreed);
+
+	items[ItemsCount / 2] = st::memory::MemoryPoolSingleThreaded::Allocate<int64_t>();
+
+#ifndef MEMORY_POOL_CHECKED
+	//(the checked mode holds freed items in the quarantine)
+	REQUIRE( items[ItemsCount / 2] == pFreed );
+#endif
+
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+	}
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool bucket lookup")
+{
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(false);
+
+	st::memory::MemoryPoolSingleThreaded::Init(settings);
+
+	int maxItemSize = settings.GetBucketDefinition(settings.GetBucketsCount() - 1).m_ItemSize;
+	int mismatchesCount = 0;
+
+	for (int size = 1; size <= maxItemSize; size++)
+	{
+		//the smallest bucket that fits the size
+		int expectedItemSize = 0;
+
+		for (int i = 0; i < settings.GetBucketsCount(); i++)
+		{
+			expectedItemSize = std::max(settings.GetBucketDefinition(i).m_ItemSize, (int)sizeof(void*));
+
+			if (expectedItemSize >= size)
+			{
+				break;
+			}
+		}
+
+		void* p = st::memory::MemoryPoolSingleThreaded::Allocate(size);
+
+		if (st::memory::MemoryPoolSlab::FromPointer(p)->m_ItemSize != expectedItemSize)
+		{
+			mismatchesCount++;
+		}
+
+		st::memory::MemoryPoolSingleThreaded::Deallocate(p, size);
+	}
+
+	REQUIRE( mismatchesCount == 0 );
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool compile time size classes")
+{
+	static_assert(st::memory::GetDefaultSizeClassIndex(sizeof(int64_t)) == 0);
+	static_assert(st::memory::GetDefaultSizeClassIndex(100) == 4);
+	static_assert(st::memory::GetDefaultSizeClassIndex(1024 * 1024) == -1);
+
+	using MediumItem = std::aligned_storage<100>::type;
+
+	//default size classes
+	st::memory::MemoryPoolSingleThreaded::Init();
+
+	auto pItem = st::memory::MemoryPoolSingleThreaded::Allocate<MediumItem>();
+	REQUIRE( st::memory::MemoryPoolSlab::FromPointer(pItem)->m_ItemSize == 128 );
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+
+	//runtime configured size classes
+	st::memory::MemoryPoolSettings settings;
+	settings.AddBucketDefinition(32, 64, 64, false);
+	settings.AddBucketDefinition(112, 64, 64, false);
+
+	REQUIRE( settings.UsesDefaultSizeClasses() == false );
+
+	st::memory::MemoryPoolSingleThreaded::Init(settings);
+
+	pItem = st::memory::MemoryPoolSingleThreaded::Allocate<MediumItem>();
+	REQUIRE( st::memory::MemoryPoolSlab::FromPointer(pItem)->m_ItemSize == 112 );
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool lock-free buckets")
+{
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+	settings.SetSyncMode(st::memory::MemoryPoolSyncMode::LockFree);
+	settings.SetThreadCacheSize(0, 0);
+
+	st::memory::MemoryPoolMultiThreaded::Init(settings);
+
+	const int ThreadsCount = 4;
+	const int IterationsCount = 20000;
+
+	std::atomic<int> invalidValuesCount = 0;
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < ThreadsCount; i++)
+	{
+		threads.emplace_back([&invalidValuesCount, i, IterationsCount]()
+		{
+			std::vector<int64_t*> items;
+
+			for (int j = 0; j < IterationsCount; j++)
+			{
+				auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int64_t>();
+				*pItem = i * IterationsCount + j;
+				items.push_back(pItem);
+
+				//freeing half of the items right away, so items keep moving between the threads
+				if (j % 2 == 1)
+				{
+					auto pFreed = items[items.size() - 2];
+
+					if (*pFreed != i * IterationsCount + j - 1)
+					{
+						invalidValuesCount++;
+					}
+
+					st::memory::MemoryPoolMultiThreaded::Deallocate(pFreed);
+					items[items.size() - 2] = items.back();
+					items.pop_back();
+				}
+			}
+
+			for (auto pItem : items)
+			{
+				st::memory::MemoryPoolMultiThreaded::Deallocate(pItem);
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE( invalidValuesCount == 0 );
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+TEST_CASE("memory pool thread owned heaps")
+{
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+	settings.SetSyncMode(st::memory::MemoryPoolSyncMode::ThreadOwned);
+
+	st::memory::MemoryPoolMultiThreaded::Init(settings);
+
+	const int ItemsCount = 1000;
+
+	std::vector<int64_t*> items;
+
+	//producer: the calling thread
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int64_t>();
+		*pItem = i;
+		items.push_back(pItem);
+	}
+
+	//consumer: frees are remote for this thread
+	std::atomic<int> invalidValuesCount = 0;
+
+	std::thread consumer([&items, &invalidValuesCount, ItemsCount]()
+	{
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			if (*items[i] != i)
+			{
+				invalidValuesCount++;
+			}
+
+			st::memory::MemoryPoolMultiThreaded::Deallocate(items[i]);
+		}
+	});
+
+	consumer.join();
+
+	REQUIRE( invalidValuesCount == 0 );
+
+	//the producer reclaims the remote frees on its next allocation
+	auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int64_t>();
+
+#ifndef MEMORY_POOL_CHECKED
+	REQUIRE( std::find(items.begin(), items.end(), pItem) != items.end() );
+#endif
+	st::memory::MemoryPoolMultiThreaded::Deallocate(pItem);
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+TEST_CASE("memory pool empty pages release")
+{
+	st::memory::MemoryPoolSettings::BucketDefinition bucketDefinition(64, 64, 64, true);
+
+	//one extra page is retained, the others are freed as soon as they get empty
+	st::memory::MemoryPoolBucket bucket;
+	bucket.Setup(bucketDefinition, false, 1);
+
+	const int ItemsCount = 20000;
+	const int ItemsPerPage = st::memory::MemoryPoolSlab::GetItemsCapacity(64);
+
+	std::vector<void*> items;
+
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		items.push_back(bucket.Allocate());
+	}
+
+	int grownPagesCount = bucket.GetPagesCount();
+	REQUIRE( grownPagesCount == (ItemsCount + ItemsPerPage - 1) / ItemsPerPage );
+
+	for (auto pItem : items)
+	{
+		bucket.Deallocate(pItem);
+	}
+
+	REQUIRE( bucket.GetPagesCount() == 2 );
+	REQUIRE( bucket.GetEmptyExtraPagesCount() == 1 );
+	REQUIRE( bucket.GetFreeItemsCount() == bucket.GetTotalItemsCount() );
+
+	//trim frees the retained page too, the first page stays (decommitted)
+	REQUIRE( bucket.Trim(0) > 0 );
+	REQUIRE( bucket.GetPagesCount() == 1 );
+	REQUIRE( bucket.GetEmptyExtraPagesCount() == 0 );
+
+	//decommitted items are carved again
+	items.clear();
+
+	for (int i = 0; i < ItemsPerPage + 1; i++)
+	{
+		items.push_back(bucket.Allocate());
+	}
+
+	REQUIRE( bucket.GetPagesCount() == 2 );
+
+	for (auto pItem : items)
+	{
+		bucket.Deallocate(pItem);
+	}
+
+	REQUIRE( bucket.GetEmptyExtraPagesCount() == 1 );
+}
+
+
+TEST_CASE("memory pool trim")
+{
+	st::memory::MemoryPoolSingleThreaded::Init();
+
+	std::vector<int64_t*> items;
+
+	for (int i = 0; i < 100000; i++)
+	{
+		items.push_back(st::memory::MemoryPoolSingleThreaded::Allocate<int64_t>());
+	}
+
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+	}
+
+	//the default policy retains the empty pages until they are trimmed
+	REQUIRE( st::memory::MemoryPoolSingleThreaded::Trim() > 0 );
+	REQUIRE( st::memory::MemoryPoolSingleThreaded::Trim() == 0 );
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+
+	//empty extra pages are freed right away
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(false);
+	settings.SetRetainedEmptyPagesCount(0);
+
+	st::memory::MemoryPoolSingleThreaded::Init(settings);
+
+	for (auto& pItem : items)
+	{
+		pItem = st::memory::MemoryPoolSingleThreaded::Allocate<int64_t>();
+	}
+
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+	}
+
+	//only the first page is left to decommit
+	REQUIRE( st::memory::MemoryPoolSingleThreaded::Trim() <= st::memory::MemoryPoolSlab::SlabSize );
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool page backings")
+{
+	using st::memory::MemoryPoolPageBacking;
+
+	for (auto pageBacking : {MemoryPoolPageBacking::Heap, MemoryPoolPageBacking::Mmap, MemoryPoolPageBacking::HugePages})
+	{
+		st::memory::MemoryPoolSettings::BucketDefinition bucketDefinition(32, 1024, 1024, true, pageBacking);
+
+		st::memory::MemoryPoolBucket bucket;
+		bucket.Setup(bucketDefinition, false, 0);
+
+		//huge page backed pages are rounded up to whole huge pages
+		if (pageBacking == MemoryPoolPageBacking::HugePages)
+		{
+			REQUIRE( (size_t)bucket.GetTotalItemsCount() * 32 > st::memory::MemoryPoolBucket::HugePageSize / 2 );
+		}
+
+		std::vector<int64_t*> items;
+		int itemsCount = bucket.GetTotalItemsCount() * 2;
+
+		for (int i = 0; i < itemsCount; i++)
+		{
+			auto pItem = static_cast<int64_t*>(bucket.Allocate());
+			*pItem = i;
+			items.push_back(pItem);
+		}
+
+		int invalidValuesCount = 0;
+
+		for (int i = 0; i < (int)items.size(); i++)
+		{
+			auto pSlab = st::memory::MemoryPoolSlab::FromPointer(items[i]);
+
+			if (*items[i] != i || pSlab->m_pBucket != &bucket)
+			{
+				invalidValuesCount++;
+			}
+
+			bucket.Deallocate(items[i]);
+		}
+
+		REQUIRE( invalidValuesCount == 0 );
+		REQUIRE( bucket.GetPagesCount() == 1 );
+	}
+}
+
+
+namespace
+{
+	struct alignas(32) Vector8
+	{
+		float m_Values[8];
+	};
+
+	struct alignas(64) CacheLinePadded
+	{
+		int m_Value;
+	};
+
+	class alignas(128) AlignedPoolable final : public st::memory::Poolable<false>
+	{
+	public:
+		int m_Value = 0;
+	};
+
+	class alignas(alignof(std::max_align_t)) DefaultAlignedPoolable final : public st::memory::Poolable<false>
+	{
+	public:
+		char m_Data[32] = {};
+	};
+
+	template<typename T> bool IsAligned(const T* p, size_t alignment)
+	{
+		return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+	}
+}
+
+
+TEST_CASE("memory pool over-aligned allocations")
+{
+	static_assert(st::memory::GetDefaultSizeClassIndex(96, 32) == 4);
+	static_assert(st::memory::GetPoolItemAlignment(192) == 64);
+
+	st::memory::MemoryPoolSingleThreaded::Init();
+
+	int misalignedCount = 0;
+
+	//typed
+	std::vector<Vector8*> vectors;
+	std::vector<CacheLinePadded*> paddedItems;
+
+	for (int i = 0; i < 1000; i++)
+	{
+		vectors.push_back(st::memory::MemoryPoolSingleThreaded::Allocate<Vector8>());
+		paddedItems.push_back(st::memory::MemoryPoolSingleThreaded::Allocate<CacheLinePadded>());
+
+		misalignedCount += IsAligned(vectors.back(), alignof(Vector8)) ? 0 : 1;
+		misalignedCount += IsAligned(paddedItems.back(), alignof(CacheLinePadded)) ? 0 : 1;
+	}
+
+	for (int i = 0; i < 1000; i++)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(vectors[i]);
+		st::memory::MemoryPoolSingleThreaded::Deallocate(paddedItems[i]);
+	}
+
+	//sizes and alignments that don't match any bucket directly, including the heap fallbacks
+	for (size_t alignment = 8; alignment <= 8192; alignment *= 2)
+	{
+		for (size_t size : {alignment, alignment * 3, (size_t)100, (size_t)5000, (size_t)100000})
+		{
+			void* p = st::memory::MemoryPoolSingleThreaded::Allocate(size, alignment);
+			std::memset(p, 0, size);
+
+			misalignedCount += IsAligned(p, alignment) ? 0 : 1;
+
+			st::memory::MemoryPoolSingleThreaded::Deallocate(p, size, alignment);
+		}
+	}
+
+	//allocator
+	{
+		std::vector<Vector8, st::memory::AllocatorSingleThreaded<Vector8>> allocatorVectors(3);
+		misalignedCount += IsAligned(allocatorVectors.data(), alignof(Vector8)) ? 0 : 1;
+	}
+
+	//poolable
+	auto pPoolable = new AlignedPoolable();
+	misalignedCount += IsAligned(pPoolable, alignof(AlignedPoolable)) ? 0 : 1;
+	delete pPoolable;
+
+	REQUIRE( misalignedCount == 0 );
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool size-free deallocation")
+{
+	int localValue = 0;
+	auto pHeapValue = std::make_unique<int>(0);
+
+	REQUIRE( st::memory::MemoryPoolPageMap::Contains(&localValue) == false );
+	REQUIRE( st::memory::MemoryPoolPageMap::Contains(pHeapValue.get()) == false );
+
+	//single threaded: pooled, oversized and over-aligned oversized items
+	st::memory::MemoryPoolSingleThreaded::Init();
+
+	std::vector<void*> items;
+
+	for (size_t size : {(size_t)1, (size_t)24, (size_t)100, (size_t)3000, (size_t)16 * 1024, (size_t)100000})
+	{
+		items.push_back(st::memory::MemoryPoolSingleThreaded::Allocate(size));
+		items.push_back(st::memory::MemoryPoolSingleThreaded::Allocate(size, 256));
+	}
+
+	for (auto pItem : items)
+	{
+		if (st::memory::MemoryPoolPageMap::Contains(pItem))
+		{
+			REQUIRE( st::memory::MemoryPoolSlab::FromPointer(pItem)->m_ItemSize < 100000 );
+		}
+
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+	}
+
+	items.clear();
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+
+	//multithreaded: items go back through the thread caches
+	st::memory::MemoryPoolMultiThreaded::Init();
+
+	std::thread worker([&items]()
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			items.push_back(st::memory::MemoryPoolMultiThreaded::Allocate(8 + i % 200));
+		}
+	});
+
+	worker.join();
+
+	int notPooledCount = 0;
+
+	for (auto pItem : items)
+	{
+		notPooledCount += st::memory::MemoryPoolPageMap::Contains(pItem) ? 0 : 1;
+		st::memory::MemoryPoolMultiThreaded::Deallocate(pItem);
+	}
+
+	REQUIRE( notPooledCount == 0 );
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+namespace
+{
+	class BatchPoolable final : public st::memory::Poolable<true>
+	{
+	public:
+
+		explicit BatchPoolable(int value) : m_Value(value)
+		{
+
+		}
+
+		int m_Value;
+		char m_Data[40];
+	};
+}
+
+
+TEST_CASE("memory pool batch allocation")
+{
+	//bucket level: the batch crosses slabs and pages, items come back in any order
+	{
+		st::memory::MemoryPoolSettings::BucketDefinition bucketDefinition(32, 64, 64, true);
+
+		st::memory::MemoryPoolBucket bucket;
+		bucket.Setup(bucketDefinition, false, 0);
+
+		const int ItemsCount = 3 * st::memory::MemoryPoolSlab::GetItemsCapacity(32) + 7;
+
+		std::vector<void*> items(ItemsCount);
+		bucket.AllocateBatch(items.data(), ItemsCount);
+
+		REQUIRE( bucket.GetFreeItemsCount() == bucket.GetTotalItemsCount() - ItemsCount );
+
+		std::vector<void*> sortedItems = items;
+		std::sort(sortedItems.begin(), sortedItems.end());
+		REQUIRE( std::adjacent_find(sortedItems.begin(), sortedItems.end()) == sortedItems.end() );
+
+		//half of them one by one, the rest in a batch
+		for (int i = 0; i < ItemsCount; i += 2)
+		{
+			bucket.Deallocate(items[i]);
+		}
+
+		std::vector<void*> restItems;
+
+		for (int i = 1; i < ItemsCount; i += 2)
+		{
+			restItems.push_back(items[i]);
+		}
+
+		bucket.DeallocateBatch(restItems.data(), (int)restItems.size());
+
+		REQUIRE( bucket.GetFreeItemsCount() == bucket.GetTotalItemsCount() );
+		REQUIRE( bucket.GetEmptyExtraPagesCount() == 0 );
+	}
+
+	//pool level, every sync mode
+	const st::memory::MemoryPoolSyncMode SyncModes[] = {st::memory::MemoryPoolSyncMode::Mutex, st::memory::MemoryPoolSyncMode::LockFree, st::memory::MemoryPoolSyncMode::ThreadOwned};
+
+	for (auto syncMode : SyncModes)
+	{
+		auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+		settings.SetSyncMode(syncMode);
+
+		st::memory::MemoryPoolMultiThreaded::Init(settings);
+
+		const int ItemsCount = 1000;
+
+		int invalidValuesCount = 0;
+
+		//pooled and oversized sizes
+		for (size_t size : {(size_t)24, (size_t)100, (size_t)100000})
+		{
+			std::vector<void*> items(ItemsCount);
+			st::memory::MemoryPoolMultiThreaded::AllocateBatch(size, ItemsCount, items.data());
+
+			for (int i = 0; i < ItemsCount; i++)
+			{
+				std::memset(items[i], i & 0xff, size);
+			}
+
+			for (int i = 0; i < ItemsCount; i++)
+			{
+				invalidValuesCount += static_cast<unsigned char*>(items[i])[size - 1] == (i & 0xff) ? 0 : 1;
+			}
+
+			st::memory::MemoryPoolMultiThreaded::DeallocateBatch(items.data(), ItemsCount, size);
+		}
+
+		REQUIRE( invalidValuesCount == 0 );
+
+		//typed batch allocated here, freed on another thread (remote frees for the thread owned heaps)
+		std::vector<int64_t*> items(ItemsCount);
+		st::memory::MemoryPoolMultiThreaded::AllocateBatch(ItemsCount, items.data());
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			*items[i] = i;
+		}
+
+		std::thread worker([&items, ItemsCount]()
+		{
+			st::memory::MemoryPoolMultiThreaded::DeallocateBatch(items.data(), ItemsCount);
+		});
+
+		worker.join();
+
+		//poolable objects
+		std::vector<BatchPoolable*> objects(ItemsCount);
+		BatchPoolable::NewBatch(ItemsCount, objects.data(), 7);
+
+		int invalidObjectsCount = 0;
+
+		for (auto pObject : objects)
+		{
+			invalidObjectsCount += pObject->m_Value == 7 && st::memory::MemoryPoolPageMap::Contains(pObject) ? 0 : 1;
+		}
+
+		REQUIRE( invalidObjectsCount == 0 );
+
+		BatchPoolable::DeleteBatch(objects.data(), ItemsCount);
+
+		st::memory::MemoryPoolMultiThreaded::Release();
+	}
+}
+
+
+TEST_CASE("memory pool page growth")
+{
+	st::memory::MemoryPoolSettings::BucketDefinition bucketDefinition(64, 64, 64, true);
+
+	const int ItemsCount = 200000;
+	const int ItemsPerSlab = st::memory::MemoryPoolSlab::GetItemsCapacity(64);
+
+	//fixed extra pages are one slab each, growing ones double up to the default cap
+	st::memory::MemoryPoolBucket fixedBucket;
+	fixedBucket.Setup(bucketDefinition, false, 0);
+
+	st::memory::MemoryPoolBucket growingBucket;
+	growingBucket.Setup(bucketDefinition, false, 0, st::memory::MemoryPoolSettings::DefaultMaxExtraPageSize);
+
+	REQUIRE( growingBucket.GetNextExtraPageItemsCount() == 64 );
+
+	std::vector<void*> fixedItems;
+	std::vector<void*> growingItems;
+
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		fixedItems.push_back(fixedBucket.Allocate());
+		growingItems.push_back(growingBucket.Allocate());
+	}
+
+	REQUIRE( fixedBucket.GetPagesCount() == (ItemsCount + ItemsPerSlab - 1) / ItemsPerSlab );
+	REQUIRE( growingBucket.GetPagesCount() < fixedBucket.GetPagesCount() / 2 );
+	REQUIRE( growingBucket.GetNextExtraPageItemsCount() == (int)(st::memory::MemoryPoolSettings::DefaultMaxExtraPageSize / 64) );
+
+	//freed pages shrink the growth back
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		fixedBucket.Deallocate(fixedItems[i]);
+		growingBucket.Deallocate(growingItems[i]);
+	}
+
+	REQUIRE( growingBucket.GetPagesCount() == 1 );
+	REQUIRE( growingBucket.GetNextExtraPageItemsCount() == 64 );
+	REQUIRE( growingBucket.GetFreeItemsCount() == growingBucket.GetTotalItemsCount() );
+}
+
+
+TEST_CASE("memory pool background provisioning")
+{
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+	settings.SetSyncMode(st::memory::MemoryPoolSyncMode::Mutex);
+	settings.SetThreadCacheSize(0, 0);
+	settings.SetBackgroundProvisioning(true);
+
+	st::memory::MemoryPoolMultiThreaded::Init(settings);
+
+	const int ThreadsCount = 4;
+	const int ItemsCount = 20000;
+
+	std::atomic<int> invalidValuesCount = 0;
+
+	auto threadFunc = [&invalidValuesCount, ItemsCount](int threadIndex)
+	{
+		std::vector<int64_t*> items;
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int64_t>();
+			*pItem = threadIndex * ItemsCount + i;
+			items.push_back(pItem);
+		}
+
+		int localInvalidValuesCount = 0;
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			localInvalidValuesCount += *items[i] == threadIndex * ItemsCount + i ? 0 : 1;
+			st::memory::MemoryPoolMultiThreaded::Deallocate(items[i]);
+		}
+
+		invalidValuesCount += localInvalidValuesCount;
+	};
+
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < ThreadsCount; i++)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE( invalidValuesCount == 0 );
+
+	//the provisioner is stopped by Release, while it may be creating a page
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+TEST_CASE("memory pool profile guided settings")
+{
+	st::memory::MemoryPoolProfile profile;
+	profile.AddSizeRequests(10, 1000, 100);
+	profile.AddSizeRequests(24, 1000, 100);
+	profile.AddSizeRequests(100, 500, 50);
+	profile.AddSizeRequests(120, 500, 50);
+	profile.AddSizeRequests(1000, 20, 5);
+	profile.AddSizeRequests(100000, 3, 1);
+
+	//merged: totals add up, the larger peak is kept
+	profile.AddSizeRequests(24, 1000, 20);
+
+	//save and load
+	auto filePath = (std::filesystem::temp_directory_path() / "tests_memory_pool_profile.txt").string();
+	REQUIRE( profile.SaveToFile(filePath) );
+
+	st::memory::MemoryPoolProfile loadedProfile;
+	REQUIRE( loadedProfile.LoadFromFile(filePath) );
+	std::filesystem::remove(filePath);
+
+	REQUIRE( loadedProfile.GetSizeRequests().size() == 6 );
+
+	int invalidValuesCount = 0;
+
+	for (size_t i = 0; i < profile.GetSizeRequests().size(); i++)
+	{
+		auto& expected = profile.GetSizeRequests()[i];
+		auto& loaded = loadedProfile.GetSizeRequests()[i];
+
+		invalidValuesCount += expected.m_Size == loaded.m_Size && expected.m_RequestsTotal == loaded.m_RequestsTotal && expected.m_RequestsMax == loaded.m_RequestsMax ? 0 : 1;
+	}
+
+	REQUIRE( invalidValuesCount == 0 );
+	REQUIRE( loadedProfile.GetSizeRequests()[1].m_RequestsTotal == 2000 );
+	REQUIRE( loadedProfile.GetSizeRequests()[1].m_RequestsMax == 100 );
+
+	REQUIRE( st::memory::MemoryPoolProfile().LoadFromFile(filePath) == false );
+
+	//three buckets: the size clusters, the first pages hold their peaks. The oversized request stays oversized
+	auto settings = st::memory::GetProfileGuidedMemoryPoolSettings(loadedProfile, false, 3);
+
+	REQUIRE( settings.GetBucketsCount() == 3 );
+	REQUIRE( settings.GetBucketDefinition(0).m_ItemSize == 32 );
+	REQUIRE( settings.GetBucketDefinition(0).m_FirstPageItemsCount == 200 );
+	REQUIRE( settings.GetBucketDefinition(1).m_ItemSize == 128 );
+	REQUIRE( settings.GetBucketDefinition(1).m_FirstPageItemsCount == 100 );
+	REQUIRE( settings.GetBucketDefinition(2).m_ItemSize == 1008 );
+	REQUIRE( settings.GetBucketDefinition(2).m_FirstPageItemsCount == 5 );
+
+	//every profiled size gets its own bucket when there are enough of them
+	REQUIRE( st::memory::GetProfileGuidedMemoryPoolSettings(loadedProfile, false).GetBucketsCount() == 5 );
+
+	//an empty profile gives the default settings
+	REQUIRE( st::memory::GetProfileGuidedMemoryPoolSettings(st::memory::MemoryPoolProfile(), false).UsesDefaultSizeClasses() );
+
+	//the derived settings in use
+	st::memory::MemoryPoolSingleThreaded::Init(settings);
+
+	std::vector<void*> items;
+
+	for (size_t size : {(size_t)10, (size_t)24, (size_t)100, (size_t)120, (size_t)1000, (size_t)100000})
+	{
+		auto pItem = st::memory::MemoryPoolSingleThreaded::Allocate(size);
+		std::memset(pItem, 0xab, size);
+		items.push_back(pItem);
+	}
+
+#ifdef MEMORY_POOL_PROFILING
+	//the pool's own histogram
+	auto poolProfile = st::memory::MemoryPoolSingleThreaded::GetProfile();
+	REQUIRE( poolProfile.GetSizeRequests().size() == 6 );
+	REQUIRE( poolProfile.GetSizeRequests()[0].m_Size == 10 );
+	REQUIRE( poolProfile.GetSizeRequests()[0].m_RequestsMax == 1 );
+#endif
+
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pItem);
+	}
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool profile guided settings alignment")
+{
+	//sizes between the default alignment multiples: the bucket is rounded up, so size-only requests keep the default alignment
+	st::memory::MemoryPoolProfile profile;
+	profile.AddSizeRequests(32, 10, 10);
+	profile.AddSizeRequests(40, 1000, 1000);
+
+	auto settings = st::memory::GetProfileGuidedMemoryPoolSettings(profile, false, 1);
+
+	REQUIRE( settings.GetBucketsCount() == 1 );
+	REQUIRE( settings.GetBucketDefinition(0).m_ItemSize % alignof(std::max_align_t) == 0 );
+
+	st::memory::MemoryPoolSingleThreaded::Init(settings);
+
+	const int ItemsCount = 8;
+	int misalignedCount = 0;
+
+	std::vector<void*> items;
+	std::vector<DefaultAlignedPoolable*> poolables;
+
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		items.push_back(st::memory::MemoryPoolSingleThreaded::Allocate(32));
+		poolables.push_back(new DefaultAlignedPoolable());
+
+		misalignedCount += IsAligned(items.back(), alignof(std::max_align_t)) ? 0 : 1;
+		misalignedCount += IsAligned(poolables.back(), alignof(DefaultAlignedPoolable)) ? 0 : 1;
+	}
+
+	REQUIRE( misalignedCount == 0 );
+
+	for (int i = 0; i < ItemsCount; i++)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(items[i], 32);
+		delete poolables[i];
+	}
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool size-free deallocation of foreign items")
+{
+	st::memory::MemoryPoolSingleThreaded::Init();
+	st::memory::MemoryPoolMultiThreaded::Init();
+
+	{
+		st::memory::MemoryPoolInstanceSingleThreaded instance;
+
+		//items of the other static pool are routed to it
+		auto pMultiThreadedItem = st::memory::MemoryPoolMultiThreaded::Allocate(32);
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pMultiThreadedItem);
+
+		auto pReusedItem = st::memory::MemoryPoolMultiThreaded::Allocate(32);
+
+#ifndef MEMORY_POOL_CHECKED
+		REQUIRE( pReusedItem == pMultiThreadedItem );
+#endif
+
+		st::memory::MemoryPoolMultiThreaded::Deallocate(pReusedItem, 32);
+
+		//instance items are left alone: they don't get into the static pool buckets
+		std::vector<void*> instanceItems;
+		std::vector<void*> items;
+
+		for (int i = 0; i < 20; i++)
+		{
+			instanceItems.push_back(instance.Allocate(32));
+			st::memory::MemoryPoolSingleThreaded::Deallocate(instanceItems.back());
+		}
+
+		int foreignItemsCount = 0;
+
+		for (int i = 0; i < 20; i++)
+		{
+			items.push_back(st::memory::MemoryPoolSingleThreaded::Allocate(32));
+			foreignItemsCount += std::find(instanceItems.begin(), instanceItems.end(), items.back()) != instanceItems.end() ? 1 : 0;
+		}
+
+		REQUIRE( foreignItemsCount == 0 );
+
+		//static pool items deleted without the instance at hand go back to their pool
+		for (auto pItem : items)
+		{
+			st::memory::MemoryPoolInstanceSingleThreaded::DeallocateToOwner(pItem);
+		}
+
+		for (auto pItem : instanceItems)
+		{
+			instance.Deallocate(pItem);
+		}
+
+		//the foreign items were not counted by the pool they were sent to
+#ifdef MEMORY_POOL_STATISTICS
+		REQUIRE( st::memory::MemoryPoolSingleThreaded::GetCurrentRequestsCount(32) == 0 );
+		REQUIRE( st::memory::MemoryPoolMultiThreaded::GetCurrentRequestsCount(32) == 0 );
+#endif
+	}
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool instance size-free deallocation of foreign items")
+{
+	st::memory::MemoryPoolSingleThreaded::Init();
+
+	{
+		st::memory::MemoryPoolInstanceSingleThreaded instance;
+		st::memory::MemoryPoolInstanceSingleThreaded otherInstance;
+
+		//items of another instance are left alone: they don't get into the buckets of this one
+		std::vector<void*> otherItems;
+		std::vector<void*> items;
+
+		for (int i = 0; i < 20; i++)
+		{
+			otherItems.push_back(otherInstance.Allocate(32));
+			instance.Deallocate(otherItems.back());
+		}
+
+		int foreignItemsCount = 0;
+
+		for (int i = 0; i < 20; i++)
+		{
+			items.push_back(instance.Allocate(32));
+			foreignItemsCount += std::find(otherItems.begin(), otherItems.end(), items.back()) != otherItems.end() ? 1 : 0;
+		}
+
+		REQUIRE( foreignItemsCount == 0 );
+
+		//static pool items go back to their pool
+		auto pStaticItem = st::memory::MemoryPoolSingleThreaded::Allocate(32);
+		instance.Deallocate(pStaticItem);
+
+		auto pReusedItem = st::memory::MemoryPoolSingleThreaded::Allocate(32);
+
+#ifndef MEMORY_POOL_CHECKED
+		REQUIRE( pReusedItem == pStaticItem );
+#endif
+
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pReusedItem, 32);
+
+#ifdef MEMORY_POOL_STATISTICS
+		REQUIRE( st::memory::MemoryPoolSingleThreaded::GetCurrentRequestsCount(32) == 0 );
+#endif
+
+		for (auto pItem : items)
+		{
+			instance.Deallocate(pItem);
+		}
+
+		for (auto pItem : otherItems)
+		{
+			otherInstance.Deallocate(pItem);
+		}
+	}
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+}
+
+
+TEST_CASE("memory pool per cpu shards")
+{
+	//more threads than shards, items are freed on other threads (remote frees for the shards they come from)
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+	settings.SetSyncMode(st::memory::MemoryPoolSyncMode::PerCpu);
+	settings.SetCpuShardsCount(2);
+
+	st::memory::MemoryPoolMultiThreaded::Init(settings);
+
+	const int ThreadsCount = 8;
+	const int ItemsCount = 5000;
+
+	std::vector<std::vector<int64_t*>> threadItems(ThreadsCount);
+	std::atomic<int> invalidValuesCount = 0;
+
+	auto allocateFunc = [&threadItems, ItemsCount](int threadIndex)
+	{
+		auto& items = threadItems[threadIndex];
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			auto pItem = st::memory::MemoryPoolMultiThreaded::Allocate<int64_t>();
+			*pItem = threadIndex * ItemsCount + i;
+			items.push_back(pItem);
+		}
+
+		//a batch, freed right away
+		int64_t* batch[64];
+		st::memory::MemoryPoolMultiThreaded::AllocateBatch(64, batch);
+		st::memory::MemoryPoolMultiThreaded::DeallocateBatch(batch, 64);
+	};
+
+	auto deallocateFunc = [&threadItems, &invalidValuesCount, ItemsCount](int threadIndex)
+	{
+		auto& items = threadItems[threadIndex];
+		int localInvalidValuesCount = 0;
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			localInvalidValuesCount += *items[i] == threadIndex * ItemsCount + i ? 0 : 1;
+			st::memory::MemoryPoolMultiThreaded::Deallocate(items[i]);
+		}
+
+		invalidValuesCount += localInvalidValuesCount;
+	};
+
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < ThreadsCount; i++)
+	{
+		threads.emplace_back(allocateFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	threads.clear();
+
+	for (int i = 0; i < ThreadsCount; i++)
+	{
+		threads.emplace_back(deallocateFunc, (i + 1) % ThreadsCount);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE( invalidValuesCount == 0 );
+
+	//remote frees are reclaimed by the next allocations
+	std::vector<int64_t*> items;
+
+	for (int i = 0; i < ThreadsCount * ItemsCount; i++)
+	{
+		items.push_back(st::memory::MemoryPoolMultiThreaded::Allocate<int64_t>());
+	}
+
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolMultiThreaded::Deallocate(pItem);
+	}
+
+	st::memory::MemoryPoolMultiThreaded::Trim();
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+namespace
+{
+	class InstanceObject : public st::memory::InstancePoolable<false>, public st::memory::ReferenceCounted
+	{
+	public:
+
+		explicit InstanceObject(int value) : m_Value(value)
+		{
+
+		}
+
+		int m_Value;
+		char m_Data[100];
+	};
+
+	class SharedInstanceObject : public st::memory::InstancePoolable<true>
+	{
+	public:
+
+		explicit SharedInstanceObject(int value) : m_Value(value)
+		{
+
+		}
+
+		int m_Value;
+	};
+}
+
+
+TEST_CASE("memory pool instances")
+{
+	//two instances don't share pages, each one is dropped as a unit
+	{
+		st::memory::MemoryPoolInstanceSingleThreaded instanceA;
+		st::memory::MemoryPoolInstanceSingleThreaded instanceB;
+
+		const int ItemsCount = 1000;
+
+		std::vector<InstanceObject*> objects;
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			objects.push_back(new (i % 2 == 0 ? instanceA : instanceB) InstanceObject(i));
+		}
+
+		int invalidOwnersCount = 0;
+
+		for (int i = 0; i < ItemsCount; i++)
+		{
+			auto pExpectedInstance = i % 2 == 0 ? &instanceA : &instanceB;
+			invalidOwnersCount += st::memory::MemoryPoolInstanceSingleThreaded::FromPointer(objects[i]) == pExpectedInstance && objects[i]->m_Value == i ? 0 : 1;
+		}
+
+		REQUIRE( invalidOwnersCount == 0 );
+		REQUIRE( instanceA.GetItemsCount() == ItemsCount / 2 );
+		REQUIRE( instanceB.GetItemsCount() == ItemsCount / 2 );
+
+		//plain delete finds the instance
+		for (int i = 0; i < ItemsCount; i += 2)
+		{
+			delete objects[i];
+		}
+
+		REQUIRE( instanceA.GetItemsCount() == 0 );
+
+		//ref counted objects, the last reference deletes the object into its instance
+		{
+			auto pObject = st::memory::CreateRefCountedPointerIn<InstanceObject>(instanceA, 42);
+			REQUIRE( pObject->m_Value == 42 );
+			REQUIRE( instanceA.GetItemsCount() == 1 );
+		}
+
+		REQUIRE( instanceA.GetItemsCount() == 0 );
+
+		//containers
+		{
+			st::memory::InstanceAllocatorSingleThreaded<int> allocator(instanceA);
+			std::vector<int, st::memory::InstanceAllocatorSingleThreaded<int>> values(allocator);
+
+			for (int i = 0; i < 100; i++)
+			{
+				values.push_back(i);
+			}
+
+			REQUIRE( st::memory::MemoryPoolInstanceSingleThreaded::FromPointer(values.data()) == &instanceA );
+			REQUIRE( values[99] == 99 );
+		}
+
+		//the rest is thrown away at once, the static pools aren't involved
+		REQUIRE( instanceB.Reset() > 0 );
+		REQUIRE( instanceB.GetItemsCount() == 0 );
+
+		//the instance is usable after the reset
+		auto pObject = new (instanceB) InstanceObject(7);
+		REQUIRE( pObject->m_Value == 7 );
+		delete pObject;
+
+		//oversized and over-aligned requests
+		void* pLarge = instanceB.Allocate(100000);
+		REQUIRE( st::memory::MemoryPoolInstanceSingleThreaded::FromPointer(pLarge) == nullptr );
+		instanceB.Deallocate(pLarge);
+
+		void* pAligned = instanceB.Allocate(64, 64);
+		REQUIRE( reinterpret_cast<uintptr_t>(pAligned) % 64 == 0 );
+		instanceB.Deallocate(pAligned, 64, 64);
+	}
+
+	//thread safe instance, the objects are freed on other threads
+	{
+		st::memory::MemoryPoolInstanceMultiThreaded instance;
+
+		const int ThreadsCount = 4;
+		const int ItemsCount = 5000;
+
+		std::vector<std::vector<SharedInstanceObject*>> threadObjects(ThreadsCount);
+
+		auto allocateFunc = [&instance, &threadObjects, ItemsCount](int threadIndex)
+		{
+			for (int i = 0; i < ItemsCount; i++)
+			{
+				threadObjects[threadIndex].push_back(new (instance) SharedInstanceObject(i));
+			}
+		};
+
+		std::vector<std::thread> threads;
+
+		for (int i = 0; i < ThreadsCount; i++)
+		{
+			threads.emplace_back(allocateFunc, i);
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		REQUIRE( instance.GetItemsCount() == ThreadsCount * ItemsCount );
+
+		threads.clear();
+
+		std::atomic<int> invalidValuesCount = 0;
+
+		for (int i = 0; i < ThreadsCount; i++)
+		{
+			threads.emplace_back([&threadObjects, &invalidValuesCount, i, ItemsCount, ThreadsCount]()
+			{
+				auto& objects = threadObjects[(i + 1) % ThreadsCount];
+
+				for (int j = 0; j < ItemsCount; j++)
+				{
+					invalidValuesCount += objects[j]->m_Value == j ? 0 : 1;
+					delete objects[j];
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		REQUIRE( invalidValuesCount == 0 );
+		REQUIRE( instance.GetItemsCount() == 0 );
+	}
+}
+
+
+TEST_CASE("memory arena")
+{
+	for (auto chunkSource : {st::memory::MemoryArenaChunkSource::Mmap, st::memory::MemoryArenaChunkSource::Pool})
+	{
+		if (chunkSource == st::memory::MemoryArenaChunkSource::Pool)
+		{
+			st::memory::MemoryPoolMultiThreaded::Init();
+		}
+
+		{
+			const size_t ChunkSize = 16 * 1024;
+
+			st::memory::MemoryArena arena(ChunkSize, chunkSource);
+
+			REQUIRE( arena.GetChunksCount() == 0 );
+
+			//zero sized requests get unique pointers, a fresh arena included
+			auto pEmpty = arena.Allocate(0);
+			auto pOtherEmpty = arena.Allocate(0);
+
+			REQUIRE( pEmpty != nullptr );
+			REQUIRE( pOtherEmpty != nullptr );
+			REQUIRE( pEmpty != pOtherEmpty );
+
+			//items follow each other and keep their alignment
+			int invalidItemsCount = 0;
+			std::vector<int*> items;
+
+			for (int i = 0; i < 10000; i++)
+			{
+				auto pItem = arena.Allocate<int>();
+				*pItem = i;
+				items.push_back(pItem);
+
+				auto pAligned = arena.Allocate(24, 64);
+				invalidItemsCount += reinterpret_cast<uintptr_t>(pAligned) % 64 == 0 ? 0 : 1;
+			}
+
+			for (int i = 0; i < 10000; i++)
+			{
+				invalidItemsCount += *items[i] == i ? 0 : 1;
+			}
+
+			REQUIRE( invalidItemsCount == 0 );
+			REQUIRE( arena.GetUsedSize() >= 10000 * (sizeof(int) + 24) );
+
+			auto chunksCount = arena.GetChunksCount();
+
+			REQUIRE( chunksCount > 1 );
+			REQUIRE( arena.GetReservedSize() == chunksCount * ChunkSize );
+
+			//an oversized request gets a chunk of its own
+			auto pLarge = static_cast<char*>(arena.Allocate(ChunkSize * 4));
+			pLarge[ChunkSize * 4 - 1] = 1;
+
+			REQUIRE( arena.GetChunksCount() == chunksCount + 1 );
+
+			//the chunks are kept for the next items, the oversized one is gone
+			arena.Reset();
+
+			REQUIRE( arena.GetUsedSize() == 0 );
+			REQUIRE( arena.GetChunksCount() == chunksCount );
+
+			//containers
+			{
+				std::vector<int, st::memory::ArenaAllocator<int>> values{st::memory::ArenaAllocator<int>(arena)};
+
+				for (int i = 0; i < 1000; i++)
+				{
+					values.push_back(i);
+				}
+
+				REQUIRE( values[999] == 999 );
+			}
+
+			REQUIRE( arena.GetChunksCount() == chunksCount );
+
+			arena.Release();
+
+			REQUIRE( arena.GetChunksCount() == 0 );
+			REQUIRE( arena.GetReservedSize() == 0 );
+
+			//memory resources must not return nullptr, zero sized requests included
+			st::memory::ArenaMemoryResource resource(arena);
+
+			REQUIRE( resource.allocate(0) != nullptr );
+
+			arena.Release();
+		}
+
+		if (chunkSource == st::memory::MemoryArenaChunkSource::Pool)
+		{
+			st::memory::MemoryPoolMultiThreaded::Release();
+		}
+	}
+}
+
+
+namespace
+{
+	//nested temporaries: every level takes a buffer from the thread stack and frees it on return
+	int SumNested(int depth)
+	{
+		st::memory::MemoryStackScope scope;
+
+		const int ValuesCount = 100;
+		auto pValues = scope.Allocate<int>(ValuesCount);
+
+		for (int i = 0; i < ValuesCount; i++)
+		{
+			pValues[i] = depth;
+		}
+
+		int result = depth > 0 ? SumNested(depth - 1) : 0;
+
+		for (int i = 0; i < ValuesCount; i++)
+		{
+			result += pValues[i];
+		}
+
+		return result;
+	}
+}
+
+
+TEST_CASE("memory stack")
+{
+	{
+		st::memory::MemoryStack stack(64 * 1024);
+
+		auto marker = stack.GetMarker();
+
+		auto pFirst = stack.Allocate<int>(10);
+		auto pAligned = stack.Allocate(100, 256);
+
+		REQUIRE( reinterpret_cast<uintptr_t>(pAligned) % 256 == 0 );
+		REQUIRE( reinterpret_cast<char*>(pAligned) >= reinterpret_cast<char*>(pFirst + 10) );
+
+		auto innerMarker = stack.GetMarker();
+		auto pInner = stack.Allocate(1000);
+
+		std::memset(pInner, 1, 1000);
+
+		//the memory after the marker is handed out again
+		stack.FreeToMarker(innerMarker);
+		REQUIRE( stack.Allocate(1000) == pInner );
+
+		{
+			st::memory::MemoryStackScope scope(stack);
+			auto scopeMarker = stack.GetMarker();
+
+			auto pScoped = scope.Allocate<double>(100);
+			pScoped[99] = 1.0;
+
+			REQUIRE( stack.GetMarker() > scopeMarker );
+		}
+
+		REQUIRE( stack.GetUsedSize() > 0 );
+		REQUIRE( stack.GetMaxUsedSize() > stack.GetUsedSize() );
+
+		stack.FreeToMarker(marker);
+
+		REQUIRE( stack.GetUsedSize() == 0 );
+		REQUIRE( stack.GetCapacity() == 64 * 1024 );
+	}
+
+	//an exhausted stack hands out nullptr and stays as it was
+	{
+		st::memory::MemoryStack stack(1024);
+
+		auto pItem = stack.Allocate(100);
+		auto usedSize = stack.GetUsedSize();
+
+		REQUIRE( pItem != nullptr );
+		REQUIRE( stack.Allocate(1024) == nullptr );
+		REQUIRE( stack.GetUsedSize() == usedSize );
+		REQUIRE( stack.Allocate(100) != nullptr );
+
+		stack.FreeToMarker(0);
+	}
+
+	//thread stacks
+	{
+		REQUIRE( SumNested(10) == 100 * (10 * 11 / 2) );
+		REQUIRE( st::memory::MemoryStack::GetThreadStack().GetUsedSize() == 0 );
+
+		const int ThreadsCount = 4;
+
+		std::atomic<int> invalidResultsCount = 0;
+		std::vector<st::memory::MemoryStack*> threadStacks(ThreadsCount);
+		std::vector<std::thread> threads;
+
+		for (int i = 0; i < ThreadsCount; i++)
+		{
+			threads.emplace_back([&invalidResultsCount, &threadStacks, i]()
+			{
+				threadStacks[i] = &st::memory::MemoryStack::GetThreadStack();
+
+				for (int j = 0; j < 1000; j++)
+				{
+					invalidResultsCount += SumNested(j % 20) == 100 * ((j % 20) * (j % 20 + 1) / 2) ? 0 : 1;
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		REQUIRE( invalidResultsCount == 0 );
+
+		std::sort(threadStacks.begin(), threadStacks.end());
+		REQUIRE( std::unique(threadStacks.begin(), threadStacks.end()) == threadStacks.end() );
+	}
+}
+
+
+TEST_CASE("memory frame allocator")
+{
+	for (int framesCount = st::memory::MemoryFrameAllocator::MinFramesCount; framesCount <= st::memory::MemoryFrameAllocator::MaxFramesCount; framesCount++)
+	{
+		const size_t FrameCapacity = 1024 * 1024;
+		const int ThreadsCount = 4;
+		const int ThreadItemsCount = 1000;
+
+		st::memory::MemoryFrameAllocator allocator(FrameCapacity, framesCount);
+
+		REQUIRE( allocator.GetFramesCount() == framesCount );
+
+		//items of the frames still in flight, by frame number
+		std::vector<std::vector<int*>> frameItems;
+
+		int invalidItemsCount = 0;
+
+		for (int frame = 0; frame < 10; frame++)
+		{
+			//parallel producers
+			std::vector<std::vector<int*>> threadItems(ThreadsCount);
+			std::vector<std::thread> threads;
+
+			for (int i = 0; i < ThreadsCount; i++)
+			{
+				threads.emplace_back([&allocator, &threadItems, i, frame, ThreadItemsCount]()
+				{
+					for (int j = 0; j < ThreadItemsCount; j++)
+					{
+						auto pItem = allocator.Allocate<int>(4);
+						pItem[0] = frame;
+						pItem[3] = j;
+						threadItems[i].push_back(pItem);
+					}
+				});
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+
+			std::vector<int*> items;
+
+			for (auto& itemsOfThread : threadItems)
+			{
+				items.insert(items.end(), itemsOfThread.begin(), itemsOfThread.end());
+			}
+
+			frameItems.push_back(std::move(items));
+
+			//the items of the previous frames in flight are intact
+			for (int previousFrame = std::max(0, frame - framesCount + 1); previousFrame <= frame; previousFrame++)
+			{
+				for (auto pItem : frameItems[previousFrame])
+				{
+					invalidItemsCount += pItem[0] == previousFrame ? 0 : 1;
+				}
+			}
+
+			auto usedSize = allocator.AdvanceFrame();
+
+			invalidItemsCount += usedSize == ThreadsCount * ThreadItemsCount * sizeof(int) * 4 ? 0 : 1;
+		}
+
+		REQUIRE( invalidItemsCount == 0 );
+		REQUIRE( allocator.GetFrameNumber() == 10 );
+		REQUIRE( allocator.GetCurrentFrameUsedSize() == 0 );
+		REQUIRE( allocator.GetLastFrameUsedSize() == ThreadsCount * ThreadItemsCount * sizeof(int) * 4 );
+		REQUIRE( allocator.GetPeakFrameUsedSize() == allocator.GetLastFrameUsedSize() );
+
+		//over-aligned items
+		auto pAligned = allocator.Allocate(10, 256);
+		REQUIRE( reinterpret_cast<uintptr_t>(pAligned) % 256 == 0 );
+	}
+
+	//an exhausted frame hands out nullptr until the next one
+	{
+		const size_t FrameCapacity = 1024;
+
+		st::memory::MemoryFrameAllocator allocator(FrameCapacity);
+
+		REQUIRE( allocator.Allocate(FrameCapacity) != nullptr );
+		REQUIRE( allocator.Allocate(1) == nullptr );
+		REQUIRE( allocator.Allocate(1) == nullptr );
+		REQUIRE( allocator.GetCurrentFrameUsedSize() > FrameCapacity );
+
+		allocator.AdvanceFrame();
+
+		REQUIRE( allocator.GetLastFrameUsedSize() > FrameCapacity );
+		REQUIRE( allocator.Allocate(FrameCapacity) != nullptr );
+	}
+}
+
+
+TEST_CASE("memory pool memory resources")
+{
+	auto fill = [](std::pmr::memory_resource* pResource)
+	{
+		std::pmr::vector<int> values(pResource);
+		std::pmr::unordered_map<int, std::pmr::string> names(pResource);
+
+		for (int i = 0; i < 1000; i++)
+		{
+			values.push_back(i);
+			names.emplace(i, "a name that doesn't fit into the small string buffer " + std::to_string(i));
+		}
+
+		int invalidItemsCount = 0;
+
+		for (int i = 0; i < 1000; i++)
+		{
+			invalidItemsCount += values[i] == i && names[i].get_allocator().resource() == pResource ? 0 : 1;
+		}
+
+		return invalidItemsCount;
+	};
+
+	//static pools
+	{
+		st::memory::MemoryPoolSingleThreaded::Init();
+		st::memory::MemoryPoolMultiThreaded::Init();
+
+		auto pResource = st::memory::PoolMemoryResourceSingleThreaded::Get();
+
+		REQUIRE( fill(pResource) == 0 );
+		REQUIRE( fill(st::memory::PoolMemoryResourceMultiThreaded::Get()) == 0 );
+
+		{
+			std::pmr::vector<int> values({1, 2, 3}, pResource);
+			REQUIRE( st::memory::MemoryPoolPageMap::Contains(values.data()) );
+		}
+
+		st::memory::PoolMemoryResourceSingleThreaded otherResource;
+		REQUIRE( otherResource.is_equal(*pResource) );
+		REQUIRE( pResource->is_equal(*st::memory::PoolMemoryResourceMultiThreaded::Get()) == false );
+
+		st::memory::MemoryPoolMultiThreaded::Release();
+		st::memory::MemoryPoolSingleThreaded::Release();
+	}
+
+	//instances, every item goes back to its bucket
+	{
+		st::memory::MemoryPoolInstanceMultiThreaded instance;
+		st::memory::InstanceMemoryResourceMultiThreaded resource(instance);
+
+		REQUIRE( fill(&resource) == 0 );
+		REQUIRE( instance.GetItemsCount() == 0 );
+
+		std::pmr::unordered_map<int, int> values(&resource);
+		values[1] = 1;
+
+		REQUIRE( instance.GetItemsCount() > 0 );
+		REQUIRE( resource.is_equal(st::memory::InstanceMemoryResourceMultiThreaded(instance)) );
+	}
+
+	//arenas
+	{
+		st::memory::MemoryArena arena;
+		st::memory::ArenaMemoryResource resource(arena);
+
+		REQUIRE( fill(&resource) == 0 );
+		REQUIRE( arena.GetUsedSize() > 0 );
+	}
+}
+
+
+namespace
+{
+	//an expensive to construct object with an internal buffer
+	class PooledMessage
+	{
+	public:
+
+		explicit PooledMessage(int id) : m_Id(id)
+		{
+			s_ConstructionsCount++;
+			m_Buffer.reserve(1024);
+		}
+
+		void Reset()
+		{
+			m_Buffer.clear();
+		}
+
+		static inline int s_ConstructionsCount = 0;
+
+		int m_Id;
+		std::vector<char> m_Buffer;
+	};
+
+	class SharedPooledMessage : public st::memory::PooledReferenceCounted<SharedPooledMessage>
+	{
+	public:
+
+		int m_Value = 0;
+	};
+}
+
+
+TEST_CASE("memory object pool")
+{
+	st::memory::MemoryPoolMultiThreaded::Init();
+
+	//handles, objects are recycled constructed
+	{
+		st::memory::ObjectPool<PooledMessage> objectPool(16);
+
+		PooledMessage::s_ConstructionsCount = 0;
+
+		std::vector<st::memory::ObjectPool<PooledMessage>::Handle> handles;
+
+		for (int i = 0; i < 100; i++)
+		{
+			handles.push_back(objectPool.Acquire(i));
+			handles.back()->m_Buffer.push_back('a');
+		}
+
+		REQUIRE( objectPool.GetLiveObjectsCount() == 100 );
+		REQUIRE( objectPool.GetPagesCount() == 7 );
+
+		//live objects in storage order
+		int expectedId = 0;
+		int invalidObjectsCount = 0;
+
+		objectPool.ForEachLive([&expectedId, &invalidObjectsCount](PooledMessage& message)
+		{
+			invalidObjectsCount += message.m_Id == expectedId ? 0 : 1;
+			expectedId++;
+		});
+
+		REQUIRE( invalidObjectsCount == 0 );
+		REQUIRE( expectedId == 100 );
+
+		//every other object goes back
+		for (int i = 0; i < 100; i += 2)
+		{
+			handles[i].Release();
+		}
+
+		int liveObjectsCount = 0;
+
+		objectPool.ForEachLive([&liveObjectsCount, &invalidObjectsCount](PooledMessage& message)
+		{
+			invalidObjectsCount += message.m_Id % 2 == 1 ? 0 : 1;
+			liveObjectsCount++;
+		});
+
+		REQUIRE( invalidObjectsCount == 0 );
+		REQUIRE( liveObjectsCount == 50 );
+
+		//recycled objects keep their buffers, Reset has cleared them
+		for (int i = 0; i < 50; i++)
+		{
+			auto handle = objectPool.Acquire(-1);
+
+			invalidObjectsCount += handle->m_Id != -1 && handle->m_Buffer.empty() && handle->m_Buffer.capacity() >= 1024 ? 0 : 1;
+		}
+
+		REQUIRE( invalidObjectsCount == 0 );
+		REQUIRE( PooledMessage::s_ConstructionsCount == 100 );
+		REQUIRE( objectPool.GetConstructedObjectsCount() == 100 );
+
+		handles.clear();
+
+		REQUIRE( objectPool.GetLiveObjectsCount() == 0 );
+	}
+
+	//rcptr, the object goes back when the last strong and weak pointers are gone
+	{
+		st::memory::ObjectPool<SharedPooledMessage> objectPool;
+
+		SharedPooledMessage* pFirstObject;
+
+		{
+			auto pMessage = objectPool.AcquireShared();
+			pMessage->m_Value = 1;
+			pFirstObject = pMessage.Get();
+
+			st::memory::wptr<SharedPooledMessage> pWeak(pMessage);
+			auto pCopy = pMessage;
+
+			pMessage.Reset();
+			pCopy.Reset();
+
+			REQUIRE( objectPool.GetLiveObjectsCount() == 1 );
+		}
+
+		REQUIRE( objectPool.GetLiveObjectsCount() == 0 );
+
+		auto pMessage = objectPool.AcquireShared();
+
+		REQUIRE( pMessage.Get() == pFirstObject );
+		REQUIRE( pMessage->m_Value == 1 );
+		REQUIRE( pMessage.GetUseCount() == 1 );
+
+		pMessage.Reset();
+
+		REQUIRE( objectPool.GetLiveObjectsCount() == 0 );
+		REQUIRE( objectPool.GetConstructedObjectsCount() == 1 );
+	}
+
+	//over-aligned objects
+	{
+		struct alignas(64) AlignedObject
+		{
+			int m_Value = 0;
+		};
+
+		st::memory::ObjectPool<AlignedObject> objectPool(3);
+		std::vector<st::memory::ObjectPool<AlignedObject>::Handle> handles;
+
+		int misalignedObjectsCount = 0;
+
+		for (int i = 0; i < 10; i++)
+		{
+			handles.push_back(objectPool.Acquire());
+			misalignedObjectsCount += reinterpret_cast<uintptr_t>(handles.back().Get()) % 64 == 0 ? 0 : 1;
+		}
+
+		REQUIRE( misalignedObjectsCount == 0 );
+	}
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+TEST_CASE("memory slot map")
+{
+	st::memory::MemoryPoolMultiThreaded::Init();
+
+	{
+		st::memory::SlotMap<std::string> slotMap;
+
+		REQUIRE( slotMap.Contains(st::memory::SlotMapHandle()) == false );
+
+		const int ValuesCount = 1000;
+
+		std::vector<st::memory::SlotMapHandle> handles;
+
+		for (int i = 0; i < ValuesCount; i++)
+		{
+			handles.push_back(slotMap.Insert(std::to_string(i)));
+		}
+
+		REQUIRE( slotMap.GetSize() == ValuesCount );
+
+		//every other value is erased, the rest stay reachable through their handles
+		int invalidValuesCount = 0;
+
+		for (int i = 0; i < ValuesCount; i += 2)
+		{
+			invalidValuesCount += slotMap.Erase(handles[i]) ? 0 : 1;
+		}
+
+		for (int i = 0; i < ValuesCount; i++)
+		{
+			auto pValue = slotMap.Get(handles[i]);
+
+			if (i % 2 == 0)
+			{
+				invalidValuesCount += pValue == nullptr && slotMap.Contains(handles[i]) == false ? 0 : 1;
+			}
+			else
+			{
+				invalidValuesCount += pValue != nullptr && *pValue == std::to_string(i) ? 0 : 1;
+			}
+		}
+
+		REQUIRE( invalidValuesCount == 0 );
+		REQUIRE( slotMap.GetSize() == ValuesCount / 2 );
+		REQUIRE( slotMap.Erase(handles[0]) == false );
+
+		//values are dense, handles of the dense values lead back to them
+		int valuesCount = 0;
+
+		for (auto& value : slotMap)
+		{
+			invalidValuesCount += std::stoi(value) % 2 == 1 ? 0 : 1;
+			invalidValuesCount += slotMap.Get(slotMap.GetHandle(valuesCount)) == &value ? 0 : 1;
+			valuesCount++;
+		}
+
+		REQUIRE( invalidValuesCount == 0 );
+		REQUIRE( valuesCount == ValuesCount / 2 );
+
+		//freed slots are reused with a new generation, the old handles stay stale
+		for (int i = 0; i < ValuesCount; i += 2)
+		{
+			auto handle = slotMap.Emplace("new");
+			invalidValuesCount += handle != handles[i] && slotMap.Contains(handles[i]) == false ? 0 : 1;
+		}
+
+		REQUIRE( invalidValuesCount == 0 );
+		REQUIRE( slotMap.GetSize() == ValuesCount );
+
+		slotMap.Clear();
+
+		REQUIRE( slotMap.IsEmpty() );
+		REQUIRE( slotMap.Get(handles[1]) == nullptr );
+	}
+
+	//a slot churned past its generations: the stale handle never matches again, the slot is retired instead of wrapping around
+	{
+		st::memory::SlotMap<int> slotMap;
+
+		auto keptHandle = slotMap.Insert(-1);
+		auto staleHandle = slotMap.Insert(0);
+		slotMap.Erase(staleHandle);
+
+		const int CyclesCount = 10000;
+		int staleMatchesCount = 0;
+
+		for (int i = 1; i <= CyclesCount; i++)
+		{
+			auto handle = slotMap.Insert(i);
+
+			staleMatchesCount += slotMap.Contains(staleHandle) || slotMap.Get(staleHandle) != nullptr || slotMap.Erase(staleHandle) ? 1 : 0;
+
+			slotMap.Erase(handle);
+		}
+
+		REQUIRE( staleMatchesCount == 0 );
+		REQUIRE( slotMap.GetSize() == 1 );
+		REQUIRE( *slotMap.Get(keptHandle) == -1 );
+	}
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+
+
+#ifdef MEMORY_POOL_CHECKED
+TEST_CASE("memory pool checked mode")
+{
+	using Checks = st::memory::MemoryPoolChecks;
+
+	st::memory::MemoryPoolSingleThreaded::Init(st::memory::GetDefaultMemoryPoolSettings(false));
+
+	int failuresCount = Checks::GetFailuresCount();
+
+	//valid requests, freed items wait in the quarantine
+	std::vector<void*> items;
+
+	for (int i = 0; i < 3000; i++)
+	{
+		auto pItem = st::memory::MemoryPoolSingleThreaded::Allocate(24);
+		std::memset(pItem, 0, 24);
+		items.push_back(pItem);
+	}
+
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolSingleThreaded::Deallocate(pItem, 24);
+	}
+
+	REQUIRE( Checks::GetFailuresCount() == failuresCount );
+
+	//double free, the second one is ignored
+	auto pItem = static_cast<char*>(st::memory::MemoryPoolSingleThreaded::Allocate(24));
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem, 24);
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem, 24);
+
+	REQUIRE( Checks::GetFailuresCount() == failuresCount + 1 );
+
+	//misaligned free
+	pItem = static_cast<char*>(st::memory::MemoryPoolSingleThreaded::Allocate(24));
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem + 8, 24);
+
+	REQUIRE( Checks::GetFailuresCount() == failuresCount + 2 );
+
+	//write past the requested size, caught by the canary
+	pItem[25] = 1;
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem, 24);
+
+	REQUIRE( Checks::GetFailuresCount() == failuresCount + 3 );
+
+	//write after free, caught when the item leaves the quarantine
+	pItem = static_cast<char*>(st::memory::MemoryPoolSingleThreaded::Allocate(24));
+	st::memory::MemoryPoolSingleThreaded::Deallocate(pItem, 24);
+	pItem[16] = 1;
+
+	//the rejected frees are not counted
+#ifdef MEMORY_POOL_STATISTICS
+	REQUIRE( st::memory::MemoryPoolSingleThreaded::GetCurrentRequestsCount(24) == 0 );
+#endif
+
+	st::memory::MemoryPoolSingleThreaded::Release();
+
+	REQUIRE( Checks::GetFailuresCount() == failuresCount + 4 );
+}
+#endif
+
+
+TEST_CASE("memory pool leak tracker")
+{
+	st::memory::MemoryPoolLeakTracker tracker(1);
+
+	int64_t items[16];
+
+	//two call sites: 10 items of 8 bytes, then 6 items of 16 bytes
+	int notSampledCount = 0;
+
+	for (int i = 0; i < 10; i++)
+	{
+		notSampledCount += tracker.ShouldSample() ? 0 : 1;
+		tracker.OnAllocate(&items[i], 8);
+	}
+
+	for (int i = 10; i < 16; i++)
+	{
+		tracker.OnAllocate(&items[i], 16);
+	}
+
+	REQUIRE( notSampledCount == 0 );
+
+	REQUIRE( tracker.GetLiveAllocationsCount() == 16 );
+
+	//untracked pointers are ignored
+	int64_t untrackedItem;
+	tracker.OnDeallocate(&untrackedItem);
+
+	for (int i = 0; i < 4; i++)
+	{
+		tracker.OnDeallocate(&items[i]);
+	}
+
+	auto report = tracker.GetReport();
+
+	REQUIRE( report.size() == 2 );
+	REQUIRE( report[0].m_AllocationsCount == 6 );
+	REQUIRE( report[0].m_Bytes == 96 );
+	REQUIRE( report[1].m_AllocationsCount == 6 );
+	REQUIRE( report[1].m_Bytes == 48 );
+
+#ifndef _WIN32
+	REQUIRE( report[0].m_Frames.empty() == false );
+	REQUIRE( st::memory::MemoryPoolLeakTracker::GetFramesDescriptions(report[0].m_Frames).size() == report[0].m_Frames.size() );
+#endif
+
+	for (int i = 4; i < 16; i++)
+	{
+		tracker.OnDeallocate(&items[i]);
+	}
+
+	REQUIRE( tracker.GetLiveAllocationsCount() == 0 );
+	REQUIRE( tracker.GetReport().empty() );
+
+	//every 4th allocation of the thread is sampled
+	st::memory::MemoryPoolLeakTracker sampledTracker(4);
+
+	int sampledCount = 0;
+
+	for (int i = 0; i < 100; i++)
+	{
+		sampledCount += sampledTracker.ShouldSample() ? 1 : 0;
+	}
+
+	REQUIRE( sampledCount == 25 );
+}
+
+
+#ifdef MEMORY_POOL_LEAK_TRACKING
+TEST_CASE("memory pool leak tracking")
+{
+	auto settings = st::memory::GetDefaultMemoryPoolSettings(true);
+	settings.SetLeakTrackingSampleInterval(1);
+
+	st::memory::MemoryPoolMultiThreaded::Init(settings);
+
+	std::vector<void*> items;
+
+	for (int i = 0; i < 20; i++)
+	{
+		items.push_back(st::memory::MemoryPoolMultiThreaded::Allocate(24));
+	}
+
+	//a batch, all but one item freed right away
+	void* batch[8];
+	st::memory::MemoryPoolMultiThreaded::AllocateBatch(40, 8, batch);
+	st::memory::MemoryPoolMultiThreaded::DeallocateBatch(batch, 7, 40);
+
+	//an oversized allocation is tracked too
+	auto pOversized = st::memory::MemoryPoolMultiThreaded::Allocate(1024 * 1024);
+
+	auto report = st::memory::MemoryPoolMultiThreaded::GetLeakReport();
+
+	REQUIRE( report.size() == 3 );
+	REQUIRE( report[0].m_AllocationsCount == 1 );
+	REQUIRE( report[0].m_Bytes == 1024 * 1024 );
+	REQUIRE( report[1].m_AllocationsCount == 20 );
+	REQUIRE( report[1].m_Bytes == 20 * 24 );
+	REQUIRE( report[2].m_AllocationsCount == 1 );
+	REQUIRE( report[2].m_Bytes == 40 );
+
+	st::memory::MemoryPoolMultiThreaded::Deallocate(pOversized);
+	st::memory::MemoryPoolMultiThreaded::Deallocate(batch[7], 40);
+
+	//size-free deallocation
+	for (auto pItem : items)
+	{
+		st::memory::MemoryPoolMultiThreaded::Deallocate(pItem);
+	}
+
+	REQUIRE( st::memory::MemoryPoolMultiThreaded::GetLeakReport().empty() );
+
+	st::memory::MemoryPoolMultiThreaded::Release();
+}
+#endif